@@ -0,0 +1,141 @@
+#include "blur.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+#include "gl_state.h"
+#include "resources.h"
+
+std::optional<Blur> blurInit() {
+    // the centre and the four corners of the destination texel, which are a
+    // source texel out, each of them a bilinear average of four texels
+    const ShaderCodes down_shader_codes = {
+        .vert = FULLSCREEN_VERTEX_SHADER,
+        .frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) in vec2 in_uv;"
+        ""
+        "layout (location = 0) out vec4 frag_color;"
+        ""
+        "uniform sampler2D u_source;"
+        ""
+        "void main() {"
+            "vec2 half_texel = 1.0 / vec2(textureSize(u_source, 0));"
+            "vec4 sum = textureLod(u_source, in_uv, 0.0) * 4.0;"
+            "sum += textureLod(u_source, in_uv - half_texel, 0.0);"
+            "sum += textureLod(u_source, in_uv + half_texel, 0.0);"
+            "sum += textureLod(u_source, in_uv + vec2(half_texel.x, -half_texel.y), 0.0);"
+            "sum += textureLod(u_source, in_uv - vec2(half_texel.x, -half_texel.y), 0.0);"
+            "frag_color = sum / 8.0;"
+        "}",
+    };
+
+    // four taps a destination texel out along the axes and four at the
+    // diagonal half a texel out, which weigh twice as much
+    const ShaderCodes up_shader_codes = {
+        .vert = FULLSCREEN_VERTEX_SHADER,
+        .frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) in vec2 in_uv;"
+        ""
+        "layout (location = 0) out vec4 frag_color;"
+        ""
+        "uniform sampler2D u_source;"
+        ""
+        "void main() {"
+            "vec2 half_texel = 0.25 / vec2(textureSize(u_source, 0));"
+            "vec4 sum = textureLod(u_source, in_uv + vec2(-2.0 * half_texel.x, 0.0), 0.0);"
+            "sum += textureLod(u_source, in_uv + vec2(2.0 * half_texel.x, 0.0), 0.0);"
+            "sum += textureLod(u_source, in_uv + vec2(0.0, -2.0 * half_texel.y), 0.0);"
+            "sum += textureLod(u_source, in_uv + vec2(0.0, 2.0 * half_texel.y), 0.0);"
+            "sum += textureLod(u_source, in_uv - half_texel, 0.0) * 2.0;"
+            "sum += textureLod(u_source, in_uv + half_texel, 0.0) * 2.0;"
+            "sum += textureLod(u_source, in_uv + vec2(half_texel.x, -half_texel.y), 0.0) * 2.0;"
+            "sum += textureLod(u_source, in_uv - vec2(half_texel.x, -half_texel.y), 0.0) * 2.0;"
+            "frag_color = sum / 12.0;"
+        "}",
+    };
+
+    auto down_program = compileShader(down_shader_codes);
+    if (!down_program) return std::nullopt;
+    auto up_program = compileShader(up_shader_codes);
+    if (!up_program) {
+        glDeleteProgram(down_program.value());
+        return std::nullopt;
+    }
+
+    Blur blur = {
+        .down_program = down_program.value(),
+        .up_program = up_program.value(),
+    };
+    glGenFramebuffers(1, &blur.framebuffer);
+    if (dsaSupported()) {
+        glCreateVertexArrays(1, &blur.empty_vert_arr);
+    } else {
+        glGenVertexArrays(1, &blur.empty_vert_arr);
+    }
+
+    return blur;
+}
+
+void blurBuildPyramid(const Blur& blur, GLuint source, const RenderTarget& pyramid, float radius) {
+    // every level down doubles the radius, which the way back up keeps
+    const float texels = std::max(1.0f, radius * pyramid.height);
+    const int32_t depth = std::clamp(int32_t(std::round(std::log2(texels))), 0, pyramid.levels - 1);
+
+    glStateBindFramebuffer(GL_FRAMEBUFFER, blur.framebuffer);
+    glStateBlend(false);
+
+    glStateUseProgram(blur.down_program);
+    glStateBindVertexArray(blur.empty_vert_arr);
+
+    for (int32_t level = 0; level <= depth; level++) {
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, pyramid.texture, level);
+        glStateViewport(0, 0, std::max(1, pyramid.width >> level), std::max(1, pyramid.height >> level));
+
+        // the level above is the only one the pass can see, so it never
+        // samples the level it renders to
+        if (level == 0) {
+            glStateBindTexture(0, source);
+        } else {
+            glStateBindTexture(0, pyramid.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        }
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    // the downsampled levels are not needed any more once the level below
+    // them has been upsampled, so the way back up overwrites them
+    glStateUseProgram(blur.up_program);
+    glStateBindTexture(0, pyramid.texture);
+    for (int32_t level = depth - 1; level >= 0; level--) {
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, pyramid.texture, level);
+        glStateViewport(0, 0, std::max(1, pyramid.width >> level), std::max(1, pyramid.height >> level));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level + 1);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    glStateBindTexture(0, pyramid.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, pyramid.levels - 1);
+
+    glStateBlend(true);
+}
+
+void blurDeinit(Blur* p_blur) {
+    glDeleteProgram(p_blur->down_program);
+    glDeleteProgram(p_blur->up_program);
+    glStateDeleteFramebuffers(1, &p_blur->framebuffer);
+    glStateDeleteVertexArrays(1, &p_blur->empty_vert_arr);
+    p_blur->down_program = 0;
+    p_blur->up_program = 0;
+    p_blur->framebuffer = 0;
+    p_blur->empty_vert_arr = 0;
+}
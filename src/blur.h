@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <optional>
+
+struct RenderTarget;
+
+// Dual Kawase blur of a texture into the first level of a pyramid, each level
+// half the size of the one above it with the first at half the source size.
+// The source is downsampled level by level as deep as the radius needs, then
+// upsampled back up to the first level, which holds the blurred texture. Every
+// level has a quarter of the pixels of the one above, so a larger radius
+// costs little more.
+struct Blur {
+    GLuint down_program;
+    GLuint up_program;
+    // the levels of the pyramid are attached to it in turn
+    GLuint framebuffer;
+    // the passes use gl_VertexID only
+    GLuint empty_vert_arr;
+};
+
+std::optional<Blur> blurInit();
+// blurs the source texture into the first level of the pyramid (a target with
+// mip levels, half the size of the source), radius is in uv of the source and
+// is rounded to a power of two texels of the first level
+void blurBuildPyramid(const Blur& blur, GLuint source, const RenderTarget& pyramid, float radius);
+void blurDeinit(Blur* p_blur);
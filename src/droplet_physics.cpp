@@ -0,0 +1,407 @@
+#include "droplet_physics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <print>
+#include <random>
+#include <thread>
+#include <vector>
+
+// droplets condensing per second, as a share of the capacity
+const float CONDENSATION_RATE = 0.05;
+const float MIN_CONDENSED_RADIUS = 0.0003;
+const float MAX_CONDENSED_RADIUS = 0.0012;
+// radius gained per second while it sits on the glass
+const float GROWTH = 0.00008;
+// droplets start sliding above this radius, faster the heavier they are
+const float SLIDE_RADIUS = 0.005;
+const float MAX_SLIDE_SPEED = 0.4;
+// how quickly a droplet picks up or loses speed, per second
+const float SLIDE_ACCELERATION = 4.0;
+// sideways wander of sliding droplets, relative to their speed
+const float WANDER = 0.3;
+// longer frames are simulated as this long, so droplets do not tunnel
+// through each other after a hitch
+const float MAX_DT = 1.0 / 20.0;
+
+void workerLoop(DropletWorkers* p_workers);
+void runChunks(DropletWorkers* p_workers);
+void parallelFor(DropletWorkers* p_workers, size_t count, std::function<void(size_t begin, size_t end)> job);
+size_t chunkCount(size_t count);
+void condense(DropletPhysics* p_physics, size_t count);
+float buildGrid(DropletPhysics* p_physics);
+void findMergeTargets(DropletPhysics* p_physics, float max_radius, size_t begin, size_t end);
+void merge(DropletPhysics* p_physics);
+
+std::optional<DropletPhysics> dropletPhysicsInit(size_t capacity, float aspect) {
+    const float cell_size = 2.0f * DROPLET_PHYSICS_MAX_RADIUS;
+    DropletPhysics physics = {
+        .capacity = capacity,
+        .aspect = aspect,
+        .gen = std::mt19937(std::random_device()()),
+        .grid_width = std::max(int32_t(std::ceil(aspect / cell_size)), 1),
+        .grid_height = int32_t(std::ceil(1.0f / cell_size)),
+        .cpu_ms = 0.0,
+        .workers = std::make_unique<DropletWorkers>(),
+    };
+    physics.droplets.reserve(capacity);
+    physics.sprites.reserve(capacity);
+    physics.cell_starts.resize(size_t(physics.grid_width) * physics.grid_height + 1);
+
+    // the thread calling the update works too
+    const uint32_t thread_count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    DropletWorkers* p_workers = physics.workers.get();
+    for (uint32_t i = 0; i < thread_count; i++) {
+        p_workers->threads.emplace_back(workerLoop, p_workers);
+    }
+
+    // the glass starts out misted over rather than dry
+    condense(&physics, capacity / 2);
+    std::println("INFO: Simulating up to {} droplets on {} threads", capacity, thread_count + 1);
+    return physics;
+}
+
+void workerLoop(DropletWorkers* p_workers) {
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock lock(p_workers->mutex);
+            p_workers->wake.wait(lock, [&] { return p_workers->quit || p_workers->generation != generation; });
+            if (p_workers->quit) return;
+            generation = p_workers->generation;
+        }
+        runChunks(p_workers);
+        {
+            std::lock_guard lock(p_workers->mutex);
+            p_workers->busy -= 1;
+            if (p_workers->busy == 0) p_workers->finished.notify_one();
+        }
+    }
+}
+
+void runChunks(DropletWorkers* p_workers) {
+    const size_t chunk_count = (p_workers->job_size + DROPLET_PHYSICS_CHUNK - 1) / DROPLET_PHYSICS_CHUNK;
+    for (size_t chunk = p_workers->next_chunk++; chunk < chunk_count; chunk = p_workers->next_chunk++) {
+        const size_t begin = chunk * DROPLET_PHYSICS_CHUNK;
+        p_workers->job(begin, std::min(begin + DROPLET_PHYSICS_CHUNK, p_workers->job_size));
+    }
+}
+
+// calls the job on chunks of [0, count) from all the threads and returns
+// once every chunk is done. The chunks are the same on one thread, so a job
+// may keep results per chunk, at begin / DROPLET_PHYSICS_CHUNK.
+void parallelFor(DropletWorkers* p_workers, size_t count, std::function<void(size_t begin, size_t end)> job) {
+    if (count <= DROPLET_PHYSICS_CHUNK || p_workers->threads.empty()) {
+        for (size_t begin = 0; begin < count; begin += DROPLET_PHYSICS_CHUNK) {
+            job(begin, std::min(begin + DROPLET_PHYSICS_CHUNK, count));
+        }
+        return;
+    }
+
+    {
+        std::lock_guard lock(p_workers->mutex);
+        p_workers->job = std::move(job);
+        p_workers->job_size = count;
+        p_workers->next_chunk = 0;
+        p_workers->busy = p_workers->threads.size();
+        p_workers->generation += 1;
+    }
+    p_workers->wake.notify_all();
+    runChunks(p_workers);
+
+    std::unique_lock lock(p_workers->mutex);
+    p_workers->finished.wait(lock, [&] { return p_workers->busy == 0; });
+    p_workers->job = nullptr;
+}
+
+size_t chunkCount(size_t count) {
+    return (count + DROPLET_PHYSICS_CHUNK - 1) / DROPLET_PHYSICS_CHUNK;
+}
+
+// every chunk of new droplets gets its own generator, seeded from the one of
+// the simulation
+void condense(DropletPhysics* p_physics, size_t count) {
+    count = std::min(count, p_physics->capacity - p_physics->droplets.size());
+    const size_t first = p_physics->droplets.size();
+    const uint32_t seed = p_physics->gen();
+    const float aspect = p_physics->aspect;
+    p_physics->droplets.resize(first + count);
+    parallelFor(p_physics->workers.get(), count, [p_physics, first, seed, aspect](size_t begin, size_t end) {
+        std::mt19937 gen(seed + uint32_t(begin / DROPLET_PHYSICS_CHUNK));
+        std::uniform_real_distribution<float> x(0.0, aspect);
+        std::uniform_real_distribution<float> y(0.0, 1.0);
+        std::uniform_real_distribution<float> radius(MIN_CONDENSED_RADIUS, MAX_CONDENSED_RADIUS);
+        std::uniform_int_distribution<uint32_t> shape(0, DROPLET_PHYSICS_SHAPES - 1);
+        for (size_t i = begin; i < end; i++) {
+            p_physics->droplets[first + i] = {
+                .pos = glm::vec2(x(gen), y(gen)),
+                .radius = radius(gen),
+                .speed = 0.0,
+                .shape = shape(gen),
+            };
+        }
+    });
+}
+
+void dropletPhysicsUpdate(DropletPhysics* p_physics, float dt) {
+    const auto start = std::chrono::steady_clock::now();
+    dt = std::min(dt, MAX_DT);
+    std::vector<PhysicsDroplet>& droplets = p_physics->droplets;
+
+    const float expected = CONDENSATION_RATE * p_physics->capacity * dt;
+    if (expected > 0.0f) {
+        condense(p_physics, std::poisson_distribution<size_t>(expected)(p_physics->gen));
+    }
+
+    const float aspect = p_physics->aspect;
+    parallelFor(p_physics->workers.get(), droplets.size(), [&droplets, aspect, dt](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            PhysicsDroplet& droplet = droplets[i];
+            droplet.radius = std::min(droplet.radius + GROWTH * dt, DROPLET_PHYSICS_MAX_RADIUS);
+
+            const float heaviness = (droplet.radius - SLIDE_RADIUS) / (DROPLET_PHYSICS_MAX_RADIUS - SLIDE_RADIUS);
+            const float target_speed = heaviness > 0.0f ? heaviness * MAX_SLIDE_SPEED : 0.0f;
+            droplet.speed += (target_speed - droplet.speed) * std::min(SLIDE_ACCELERATION * dt, 1.0f);
+            if (droplet.speed <= 0.0f) continue;
+
+            // the path wanders the same way for every droplet passing a spot,
+            // like on a real pane
+            const float wander = std::sin(60.0f * droplet.pos.y + 13.0f * droplet.pos.x);
+            droplet.pos.y -= droplet.speed * dt;
+            droplet.pos.x = std::clamp(droplet.pos.x + WANDER * wander * droplet.speed * dt, 0.0f, aspect);
+        }
+    });
+
+    const float max_radius = buildGrid(p_physics);
+    p_physics->merge_into.resize(droplets.size());
+    parallelFor(p_physics->workers.get(), droplets.size(), [p_physics, max_radius](size_t begin, size_t end) {
+        findMergeTargets(p_physics, max_radius, begin, end);
+    });
+    merge(p_physics);
+
+    p_physics->sprites.resize(droplets.size());
+    parallelFor(p_physics->workers.get(), droplets.size(), [p_physics](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const PhysicsDroplet& droplet = p_physics->droplets[i];
+            p_physics->sprites[i] = {
+                .uv = glm::vec2(droplet.pos.x / p_physics->aspect, droplet.pos.y),
+                .radius = droplet.radius,
+                .shape = float(droplet.shape),
+            };
+        }
+    });
+
+    const std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    p_physics->cpu_ms = elapsed.count();
+}
+
+// Counting sort of the droplets themselves by cell, so the droplets of a row
+// of cells lie next to each other in memory for the neighbour queries. Every
+// chunk of droplets counts its own per cell, so they are sorted to a slot of
+// their cell after the droplets of the chunks before them: their order within
+// a cell is kept and the merging does not depend on the threads. The
+// droplets that slid off the bottom are left out, and the largest radius of
+// the rest is returned.
+float buildGrid(DropletPhysics* p_physics) {
+    const uint32_t GONE = UINT32_MAX;
+    std::vector<PhysicsDroplet>& droplets = p_physics->droplets;
+    const float cell_size = 2.0f * DROPLET_PHYSICS_MAX_RADIUS;
+    const int32_t grid_width = p_physics->grid_width;
+    const int32_t grid_height = p_physics->grid_height;
+    const size_t cell_count = size_t(grid_width) * grid_height;
+    const size_t chunk_count = chunkCount(droplets.size());
+    p_physics->droplet_cells.resize(droplets.size());
+    p_physics->chunk_cell_counts.resize(chunk_count * cell_count);
+    p_physics->chunk_max_radius.resize(chunk_count);
+    parallelFor(p_physics->workers.get(), droplets.size(), [&, p_physics](size_t begin, size_t end) {
+        const size_t chunk = begin / DROPLET_PHYSICS_CHUNK;
+        uint32_t* counts = &p_physics->chunk_cell_counts[chunk * cell_count];
+        std::fill(counts, counts + cell_count, 0);
+        float max_radius = 0.0;
+        for (size_t i = begin; i < end; i++) {
+            // what slid off the bottom is gone
+            if (droplets[i].pos.y + droplets[i].radius < 0.0f) {
+                p_physics->droplet_cells[i] = GONE;
+                continue;
+            }
+            const int32_t x = std::clamp(int32_t(droplets[i].pos.x / cell_size), 0, grid_width - 1);
+            const int32_t y = std::clamp(int32_t(droplets[i].pos.y / cell_size), 0, grid_height - 1);
+            const uint32_t cell = uint32_t(y * grid_width + x);
+            p_physics->droplet_cells[i] = cell;
+            counts[cell] += 1;
+            max_radius = std::max(max_radius, droplets[i].radius);
+        }
+        p_physics->chunk_max_radius[chunk] = max_radius;
+    });
+
+    // the totals of the cells, whose prefix sum is where each starts
+    std::vector<uint32_t>& starts = p_physics->cell_starts;
+    parallelFor(p_physics->workers.get(), cell_count, [&, p_physics](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) {
+            uint32_t total = 0;
+            for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                total += p_physics->chunk_cell_counts[chunk * cell_count + cell];
+            }
+            starts[cell + 1] = total;
+        }
+    });
+    starts[0] = 0;
+    for (size_t c = 1; c < starts.size(); c++) starts[c] += starts[c - 1];
+
+    // the counts of every chunk become where its droplets of each cell go
+    parallelFor(p_physics->workers.get(), cell_count, [&, p_physics](size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; cell++) {
+            uint32_t slot = starts[cell];
+            for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+                uint32_t& count = p_physics->chunk_cell_counts[chunk * cell_count + cell];
+                const uint32_t next = slot + count;
+                count = slot;
+                slot = next;
+            }
+        }
+    });
+
+    p_physics->sorted.resize(droplets.size());
+    parallelFor(p_physics->workers.get(), droplets.size(), [&, p_physics](size_t begin, size_t end) {
+        uint32_t* slots = &p_physics->chunk_cell_counts[(begin / DROPLET_PHYSICS_CHUNK) * cell_count];
+        for (size_t i = begin; i < end; i++) {
+            const uint32_t cell = p_physics->droplet_cells[i];
+            if (cell != GONE) p_physics->sorted[slots[cell]++] = droplets[i];
+        }
+    });
+    p_physics->sorted.resize(starts[cell_count]);
+    droplets.swap(p_physics->sorted);
+
+    float max_radius = 0.0;
+    for (float radius : p_physics->chunk_max_radius) max_radius = std::max(max_radius, radius);
+    return max_radius;
+}
+
+// every droplet picks the largest droplet touching it that is larger than
+// itself (the lower index on a tie) to merge into, or stays
+void findMergeTargets(DropletPhysics* p_physics, float max_radius, size_t begin, size_t end) {
+    const std::vector<PhysicsDroplet>& droplets = p_physics->droplets;
+    const float cell_size = 2.0f * DROPLET_PHYSICS_MAX_RADIUS;
+    const int32_t grid_width = p_physics->grid_width;
+    const int32_t grid_height = p_physics->grid_height;
+    const auto larger = [&](uint32_t a, uint32_t b) {
+        return droplets[a].radius > droplets[b].radius || (droplets[a].radius == droplets[b].radius && a < b);
+    };
+
+    for (size_t i = begin; i < end; i++) {
+        const PhysicsDroplet& droplet = droplets[i];
+        // nothing further away than this can touch it
+        const float reach = droplet.radius + max_radius;
+        const int32_t x0 = std::max(int32_t((droplet.pos.x - reach) / cell_size), 0);
+        const int32_t x1 = std::min(int32_t((droplet.pos.x + reach) / cell_size), grid_width - 1);
+        const int32_t y0 = std::max(int32_t((droplet.pos.y - reach) / cell_size), 0);
+        const int32_t y1 = std::min(int32_t((droplet.pos.y + reach) / cell_size), grid_height - 1);
+
+        // the cells of a row are one run of droplets
+        uint32_t target = uint32_t(i);
+        for (int32_t y = y0; y <= y1; y++) {
+            const uint32_t first = p_physics->cell_starts[y * grid_width + x0];
+            const uint32_t last = p_physics->cell_starts[y * grid_width + x1 + 1];
+            for (uint32_t other = first; other < last; other++) {
+                const glm::vec2 d = droplets[other].pos - droplet.pos;
+                const float touch = droplets[other].radius + droplet.radius;
+                if (glm::dot(d, d) < touch * touch && larger(other, target)) target = other;
+            }
+        }
+        p_physics->merge_into[i] = target;
+    }
+}
+
+// Every droplet ends up in the one at the end of its chain of targets, which
+// keeps the volume of all of them at their volume weighted centre. Chains
+// always lead to larger droplets, so they end. Every chunk sums what merges
+// into its own droplets, from the few droplets merging in the order of the
+// chunks they are in, then writes the droplets left after those of the
+// chunks before it.
+void merge(DropletPhysics* p_physics) {
+    std::vector<PhysicsDroplet>& droplets = p_physics->droplets;
+    const std::vector<uint32_t>& merge_into = p_physics->merge_into;
+    std::vector<glm::vec4>& merged = p_physics->merged;
+    const size_t chunk_count = chunkCount(droplets.size());
+    const auto weighted = [&droplets](size_t i) {
+        const PhysicsDroplet& droplet = droplets[i];
+        const float volume = droplet.radius * droplet.radius * droplet.radius;
+        return glm::vec4(volume * droplet.pos, volume * droplet.speed, volume);
+    };
+
+    merged.resize(droplets.size());
+    p_physics->chunk_merges.resize(std::max(p_physics->chunk_merges.size(), chunk_count));
+    p_physics->chunk_kept.resize(chunk_count);
+    parallelFor(p_physics->workers.get(), droplets.size(), [&, p_physics](size_t begin, size_t end) {
+        const size_t chunk = begin / DROPLET_PHYSICS_CHUNK;
+        std::vector<glm::uvec2>& merges = p_physics->chunk_merges[chunk];
+        merges.clear();
+        uint32_t kept = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (merge_into[i] == i) {
+                merged[i] = weighted(i);
+                kept += 1;
+                continue;
+            }
+            uint32_t root = merge_into[i];
+            while (merge_into[root] != root) root = merge_into[root];
+            merges.push_back(glm::uvec2(root, i));
+        }
+        p_physics->chunk_kept[chunk] = kept;
+    });
+
+    parallelFor(p_physics->workers.get(), droplets.size(), [&, p_physics](size_t begin, size_t end) {
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            for (const glm::uvec2& merge : p_physics->chunk_merges[chunk]) {
+                if (merge.x >= begin && merge.x < end) merged[merge.x] += weighted(merge.y);
+            }
+        }
+    });
+
+    // where the droplets left of each chunk start
+    uint32_t kept = 0;
+    for (uint32_t& chunk_kept : p_physics->chunk_kept) {
+        const uint32_t next = kept + chunk_kept;
+        chunk_kept = kept;
+        kept = next;
+    }
+
+    p_physics->sorted.resize(droplets.size());
+    parallelFor(p_physics->workers.get(), droplets.size(), [&, p_physics](size_t begin, size_t end) {
+        uint32_t slot = p_physics->chunk_kept[begin / DROPLET_PHYSICS_CHUNK];
+        for (size_t i = begin; i < end; i++) {
+            if (merge_into[i] != i) continue;
+            const glm::vec4 sum = merged[i];
+            p_physics->sorted[slot++] = {
+                .pos = glm::vec2(sum) / sum.w,
+                // whatever would grow past the largest droplet runs off the glass
+                .radius = std::min(std::cbrt(sum.w), DROPLET_PHYSICS_MAX_RADIUS),
+                .speed = sum.z / sum.w,
+                .shape = droplets[i].shape,
+            };
+        }
+    });
+    p_physics->sorted.resize(kept);
+    droplets.swap(p_physics->sorted);
+}
+
+void dropletPhysicsDeinit(DropletPhysics* p_physics) {
+    DropletWorkers* p_workers = p_physics->workers.get();
+    if (p_workers) {
+        {
+            std::lock_guard lock(p_workers->mutex);
+            p_workers->quit = true;
+        }
+        p_workers->wake.notify_all();
+        for (std::thread& thread : p_workers->threads) thread.join();
+    }
+    p_physics->workers = nullptr;
+    p_physics->droplets.clear();
+    p_physics->sprites.clear();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+// largest droplet, in units of the image height, the spatial hash cells are
+// twice this so two touching droplets are at most one cell apart
+#define DROPLET_PHYSICS_MAX_RADIUS 0.01f
+// droplets spread over the workers in chunks of this many
+#define DROPLET_PHYSICS_CHUNK 2048
+// different shapes droplets are drawn with
+#define DROPLET_PHYSICS_SHAPES 8
+
+// what the sprites are drawn from, in uv, laid out like the vec4 the sprite
+// vertex shader reads
+struct DropletSprite {
+    glm::vec2 uv;
+    // in uv of the image height
+    float radius;
+    // layer of the sprite atlas
+    float shape;
+};
+
+struct PhysicsDroplet {
+    // x in [0, aspect], y in [0, 1] from the bottom, so distances are the
+    // same either way
+    glm::vec2 pos;
+    float radius;
+    float speed;
+    // the shape it condensed with, which the droplets merging into it take
+    uint32_t shape;
+};
+
+// Threads kept waiting for the next parallelFor, so a frame does not pay
+// for starting them.
+struct DropletWorkers {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    std::function<void(size_t begin, size_t end)> job;
+    size_t job_size;
+    std::atomic<size_t> next_chunk;
+    size_t busy;
+    uint64_t generation;
+    bool quit;
+};
+
+// Droplets on the glass simulated on the CPU: they condense, grow, slide
+// down once heavy enough and merge when they touch. Touching droplets are
+// found through a uniform grid of cells twice DROPLET_PHYSICS_MAX_RADIUS,
+// rebuilt every frame with a counting sort, so a query only looks at the
+// droplets of at most the 3x3 cells around it. Every stage runs on all
+// cores, split into the same chunks whatever the number of threads, so the
+// simulation does not depend on it.
+struct DropletPhysics {
+    std::vector<PhysicsDroplet> droplets;
+    size_t capacity;
+    // width over height of the glass
+    float aspect;
+    std::mt19937 gen;
+
+    int32_t grid_width;
+    int32_t grid_height;
+    std::vector<uint32_t> droplet_cells;
+    // the droplets are kept sorted by cell, this is where the ones of each
+    // cell start, and where they are sorted into
+    std::vector<uint32_t> cell_starts;
+    std::vector<PhysicsDroplet> sorted;
+    // the droplet each one merges into, or its own index
+    std::vector<uint32_t> merge_into;
+    // position and speed weighted by volume, and the volume, merged into
+    // each droplet
+    std::vector<glm::vec4> merged;
+
+    // per chunk of droplets: how many of them are in each cell (a row of
+    // cells per chunk), then where they are sorted to
+    std::vector<uint32_t> chunk_cell_counts;
+    std::vector<float> chunk_max_radius;
+    // the droplets merging into another one, with the droplet at the end of
+    // their chain, and the droplets left
+    std::vector<std::vector<glm::uvec2>> chunk_merges;
+    std::vector<uint32_t> chunk_kept;
+
+    std::vector<DropletSprite> sprites;
+    // of the last update
+    float cpu_ms;
+
+    std::unique_ptr<DropletWorkers> workers;
+};
+
+std::optional<DropletPhysics> dropletPhysicsInit(size_t capacity, float aspect);
+// advances the simulation by dt seconds and fills the sprites
+void dropletPhysicsUpdate(DropletPhysics* p_physics, float dt);
+void dropletPhysicsDeinit(DropletPhysics* p_physics);
@@ -0,0 +1,159 @@
+#include "droplet_sprites.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "gl_state.h"
+#include "resources.h"
+
+static_assert(sizeof(DropletSprite) == 4 * sizeof(float), "DropletSprite must match the vec4 of the Sprites block");
+static_assert(DROPLET_ATLAS_SHAPES == DROPLET_PHYSICS_SHAPES, "every droplet shape needs a layer of the atlas");
+
+// samples per texel and axis of the coverage of the shape edge
+const int32_t ATLAS_SUPERSAMPLING = 4;
+// height of the thickness over the radius, for the slopes of the normals
+const float ATLAS_DOME = 0.6;
+
+std::vector<unsigned char> atlasShapes();
+GLuint atlasInit();
+
+std::vector<unsigned char> atlasShapes() {
+    const int32_t size = DROPLET_ATLAS_SIZE;
+    std::vector<unsigned char> texels(4 * size_t(size) * size * DROPLET_ATLAS_SHAPES);
+    // the same shapes on every run
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> amplitude(0.0, 0.05);
+    std::uniform_real_distribution<float> phase(0.0, 6.2831853);
+
+    for (int32_t shape = 0; shape < DROPLET_ATLAS_SHAPES; shape++) {
+        // the outline wobbles with a few low harmonics, and water gathers at
+        // the bottom, squashing the top a little
+        float amplitudes[3];
+        float phases[3];
+        for (int32_t k = 0; k < 3; k++) {
+            amplitudes[k] = amplitude(gen);
+            phases[k] = phase(gen);
+        }
+        const float sag = 0.02f * shape;
+        const auto outline = [&](float angle) {
+            float r = 1.0f - sag * std::max(std::sin(angle), 0.0f);
+            for (int32_t k = 0; k < 3; k++) r -= amplitudes[k] * (0.5f + 0.5f * std::cos((k + 2) * angle + phases[k]));
+            // a texel of room so the clamped edge is empty
+            return r * (1.0f - 2.0f / size);
+        };
+        const auto height = [&](float x, float y) {
+            const float r = std::sqrt(x * x + y * y) / outline(std::atan2(y, x));
+            return r < 1.0f ? std::sqrt(1.0f - r * r) : 0.0f;
+        };
+
+        for (int32_t ty = 0; ty < size; ty++) {
+            for (int32_t tx = 0; tx < size; tx++) {
+                const float x = 2.0f * (tx + 0.5f) / size - 1.0f;
+                const float y = 2.0f * (ty + 0.5f) / size - 1.0f;
+                int32_t inside = 0;
+                for (int32_t sy = 0; sy < ATLAS_SUPERSAMPLING; sy++) {
+                    for (int32_t sx = 0; sx < ATLAS_SUPERSAMPLING; sx++) {
+                        const float px = x + 2.0f * ((sx + 0.5f) / ATLAS_SUPERSAMPLING - 0.5f) / size;
+                        const float py = y + 2.0f * ((sy + 0.5f) / ATLAS_SUPERSAMPLING - 0.5f) / size;
+                        if (height(px, py) > 0.0f) inside += 1;
+                    }
+                }
+
+                const float thickness = height(x, y);
+                const float d = 1.0f / size;
+                glm::vec2 normal = ATLAS_DOME * glm::vec2(height(x - d, y) - height(x + d, y), height(x, y - d) - height(x, y + d)) / (2.0f * d);
+                // xy of the unit normal, steepest at the rim
+                normal = normal / std::sqrt(1.0f + glm::dot(normal, normal));
+
+                unsigned char* texel = &texels[4 * ((size_t(shape) * size + ty) * size + tx)];
+                texel[0] = (unsigned char)(std::round(255.0f * (0.5f + 0.5f * normal.x)));
+                texel[1] = (unsigned char)(std::round(255.0f * (0.5f + 0.5f * normal.y)));
+                texel[2] = (unsigned char)(std::round(255.0f * thickness));
+                texel[3] = (unsigned char)(std::round(255.0f * inside / (ATLAS_SUPERSAMPLING * ATLAS_SUPERSAMPLING)));
+            }
+        }
+    }
+    return texels;
+}
+
+GLuint atlasInit() {
+    const std::vector<unsigned char> texels = atlasShapes();
+    const int32_t levels = renderTargetLevels(DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SIZE);
+    GLuint atlas = 0;
+    if (dsaSupported()) {
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &atlas);
+        glTextureStorage3D(atlas, levels, GL_RGBA8, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SHAPES);
+        glTextureSubImage3D(atlas, 0, 0, 0, 0, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SHAPES, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glTextureParameteri(atlas, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(atlas, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(atlas, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(atlas, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateTextureMipmap(atlas);
+    } else {
+        glGenTextures(1, &atlas);
+        glStateBindTexture(DROPLET_ATLAS_UNIT, atlas, GL_TEXTURE_2D_ARRAY);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SHAPES);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SIZE, DROPLET_ATLAS_SHAPES, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+    return atlas;
+}
+
+std::optional<DropletSprites> dropletSpritesInit(size_t capacity) {
+    DropletSprites sprites = {
+        .atlas = atlasInit(),
+        .capacity = capacity,
+        .count = 0,
+    };
+    const GLsizeiptr size = GLsizeiptr(std::max<size_t>(capacity, 1) * sizeof(DropletSprite));
+    if (dsaSupported()) {
+        glCreateBuffers(1, &sprites.buffer);
+        glNamedBufferStorage(sprites.buffer, size, NULL, GL_DYNAMIC_STORAGE_BIT);
+        glCreateVertexArrays(1, &sprites.empty_vert_arr);
+    } else {
+        glGenBuffers(1, &sprites.buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sprites.buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glGenVertexArrays(1, &sprites.empty_vert_arr);
+    }
+    return sprites;
+}
+
+void dropletSpritesUpload(DropletSprites* p_sprites, const std::vector<DropletSprite>& sprites) {
+    p_sprites->count = uint32_t(std::min(sprites.size(), p_sprites->capacity));
+    if (p_sprites->count == 0) return;
+
+    const GLsizeiptr size = GLsizeiptr(p_sprites->count * sizeof(DropletSprite));
+    if (dsaSupported()) {
+        glNamedBufferSubData(p_sprites->buffer, 0, size, sprites.data());
+    } else {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, p_sprites->buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, sprites.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+void dropletSpritesDraw(const Renderer& renderer, const DropletSprites& sprites) {
+    if (sprites.count == 0) return;
+    renderer.bind_texture(DROPLET_ATLAS_UNIT, sprites.atlas, RENDERER_TEXTURE_2D_ARRAY);
+    renderer.bind_storage_buffer(DROPLET_SPRITES_BINDING, sprites.buffer);
+    renderer.draw(sprites.empty_vert_arr, 0, 6, sprites.count);
+}
+
+void dropletSpritesDeinit(DropletSprites* p_sprites) {
+    glDeleteBuffers(1, &p_sprites->buffer);
+    glStateDeleteVertexArrays(1, &p_sprites->empty_vert_arr);
+    glStateDeleteTextures(1, &p_sprites->atlas);
+    *p_sprites = {};
+}
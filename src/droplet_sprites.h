@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "droplet_physics.h"
+#include "renderer.h"
+
+// binding of the Sprites storage block of the sprite vertex shader
+#define DROPLET_SPRITES_BINDING 1
+// shapes in the atlas, a layer each, and their size in texels
+#define DROPLET_ATLAS_SHAPES 8
+#define DROPLET_ATLAS_SIZE 64
+// texture unit the atlas is read from
+#define DROPLET_ATLAS_UNIT 6
+
+// The droplets of the CPU simulation, drawn as one instanced quad each that
+// refracts the scene behind it (see dropletsSprite.h). The droplet list is
+// uploaded whole every frame into a buffer the vertex shader reads. The
+// quads look their shape up in an atlas computed once at startup, so a
+// droplet pixel costs a few fetches whatever the shape.
+struct DropletSprites {
+    GLuint buffer;
+    // texture array of DROPLET_ATLAS_SHAPES layers: the normal in rg, the
+    // thickness in b and the coverage in a
+    GLuint atlas;
+    // the quads are generated from gl_VertexID and gl_InstanceID only
+    GLuint empty_vert_arr;
+    size_t capacity;
+    uint32_t count;
+};
+
+std::optional<DropletSprites> dropletSpritesInit(size_t capacity);
+void dropletSpritesUpload(DropletSprites* p_sprites, const std::vector<DropletSprite>& sprites);
+// draws the sprites with the pipeline set, whose program has to use the
+// sprite vertex shader, in the droplet pass, binds the atlas
+void dropletSpritesDraw(const Renderer& renderer, const DropletSprites& sprites);
+void dropletSpritesDeinit(DropletSprites* p_sprites);
@@ -0,0 +1,132 @@
+#include "droplet_tiles.h"
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "gl_state.h"
+#include "resources.h"
+
+// matches DrawArraysIndirectCommand
+struct DrawCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first;
+    GLuint base_instance;
+};
+
+const size_t WET_DRAW_OFFSET = 0;
+const size_t DRY_DRAW_OFFSET = sizeof(DrawCommand);
+const size_t TILES_OFFSET = 2 * sizeof(DrawCommand);
+const GLuint CLASSIFY_GROUP_SIZE = 8;
+
+uint32_t tileCount(int32_t size) {
+    return uint32_t(size + DROPLET_TILE_SIZE - 1) / DROPLET_TILE_SIZE;
+}
+
+std::optional<DropletTiles> dropletTilesInit() {
+    DropletTiles tiles = {};
+    if (dsaSupported()) {
+        glCreateVertexArrays(1, &tiles.empty_vert_arr);
+    } else {
+        glGenVertexArrays(1, &tiles.empty_vert_arr);
+    }
+    return tiles;
+}
+
+// the storage is immutable, so a new tile count means a new buffer
+void dropletTilesResize(DropletTiles* p_tiles, int32_t width, int32_t height) {
+    const uint32_t max_tiles = tileCount(width) * tileCount(height);
+    if (p_tiles->buffer != 0 && p_tiles->max_tiles == max_tiles) return;
+
+    glDeleteBuffers(1, &p_tiles->buffer);
+    p_tiles->max_tiles = max_tiles;
+    // the dry lists were filled into the old buffer
+    p_tiles->dry_width = 0;
+    p_tiles->dry_height = 0;
+
+    const size_t size = TILES_OFFSET + 2 * max_tiles * sizeof(GLuint);
+    if (dsaSupported()) {
+        glCreateBuffers(1, &p_tiles->buffer);
+        glNamedBufferStorage(p_tiles->buffer, size, NULL, GL_DYNAMIC_STORAGE_BIT);
+    } else {
+        glGenBuffers(1, &p_tiles->buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, p_tiles->buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+void dropletTilesClassify(const Renderer& renderer, const DropletTiles& tiles, GLuint program, int32_t width, int32_t height) {
+    // the vertex shader tells the lists apart by the first vertex
+    const DrawCommand commands[2] = {
+        { .count = 6, .instance_count = 0, .first = 0, .base_instance = 0 },
+        { .count = 6, .instance_count = 0, .first = 6, .base_instance = 0 },
+    };
+    if (dsaSupported()) {
+        glNamedBufferSubData(tiles.buffer, WET_DRAW_OFFSET, sizeof(commands), commands);
+    } else {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, tiles.buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, WET_DRAW_OFFSET, sizeof(commands), commands);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    renderer.bind_storage_buffer(0, tiles.buffer);
+
+    renderer.dispatch(
+        program,
+        (tileCount(width) + CLASSIFY_GROUP_SIZE - 1) / CLASSIFY_GROUP_SIZE,
+        (tileCount(height) + CLASSIFY_GROUP_SIZE - 1) / CLASSIFY_GROUP_SIZE
+    );
+
+    // the lists are read by the vertex shader, the counts by the draws
+    renderer.barrier(RENDERER_BARRIER_STORAGE_AND_COMMANDS);
+}
+
+// there is nothing to classify, so the lists are written from here, a few
+// tens of KB even for large targets, whenever the size changes
+void dropletTilesFillDry(DropletTiles* p_tiles, int32_t width, int32_t height) {
+    if (p_tiles->dry_width == width && p_tiles->dry_height == height) return;
+    p_tiles->dry_width = width;
+    p_tiles->dry_height = height;
+
+    const DropletTiles& tiles = *p_tiles;
+    const uint32_t tiles_x = tileCount(width);
+    const uint32_t tiles_y = tileCount(height);
+    std::vector<GLuint> dry_tiles;
+    dry_tiles.reserve(tiles_x * tiles_y);
+    for (uint32_t y = 0; y < tiles_y; y++) {
+        for (uint32_t x = 0; x < tiles_x; x++) dry_tiles.push_back(x | (y << 16));
+    }
+    const DrawCommand commands[2] = {
+        { .count = 6, .instance_count = 0, .first = 0, .base_instance = 0 },
+        { .count = 6, .instance_count = GLuint(dry_tiles.size()), .first = 6, .base_instance = 0 },
+    };
+    // the dry slots start after max_tiles wet ones
+    const size_t dry_offset = TILES_OFFSET + tiles.max_tiles * sizeof(GLuint);
+    if (dsaSupported()) {
+        glNamedBufferSubData(tiles.buffer, WET_DRAW_OFFSET, sizeof(commands), commands);
+        glNamedBufferSubData(tiles.buffer, dry_offset, dry_tiles.size() * sizeof(GLuint), dry_tiles.data());
+    } else {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, tiles.buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, WET_DRAW_OFFSET, sizeof(commands), commands);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, dry_offset, dry_tiles.size() * sizeof(GLuint), dry_tiles.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+}
+
+void dropletTilesDraw(const Renderer& renderer, const DropletTiles& tiles, bool wet) {
+    renderer.bind_storage_buffer(0, tiles.buffer);
+    renderer.draw_indirect(tiles.empty_vert_arr, tiles.buffer, wet ? WET_DRAW_OFFSET : DRY_DRAW_OFFSET);
+}
+
+void dropletTilesDeinit(DropletTiles* p_tiles) {
+    glDeleteBuffers(1, &p_tiles->buffer);
+    glStateDeleteVertexArrays(1, &p_tiles->empty_vert_arr);
+    p_tiles->buffer = 0;
+    p_tiles->empty_vert_arr = 0;
+    p_tiles->max_tiles = 0;
+    p_tiles->dry_width = 0;
+    p_tiles->dry_height = 0;
+}
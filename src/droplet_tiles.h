@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <optional>
+
+#include "renderer.h"
+
+// screen tiles the droplet pass is classified and drawn in, in pixels
+#define DROPLET_TILE_SIZE 16
+
+// Lists of the tiles of the droplet target that droplets can touch ("wet")
+// and the rest ("dry"), built on the GPU every frame together with the
+// indirect draw commands drawing them, so only wet tiles run the full
+// droplet shader. The buffer starts with the wet and dry commands, followed
+// by max_tiles wet and max_tiles dry slots.
+struct DropletTiles {
+    GLuint buffer;
+    // the tiles are generated from gl_VertexID and gl_InstanceID only
+    GLuint empty_vert_arr;
+    uint32_t max_tiles;
+    // the size of the target the lists were filled with every tile dry for
+    int32_t dry_width;
+    int32_t dry_height;
+};
+
+// without lists until dropletTilesResize
+std::optional<DropletTiles> dropletTilesInit();
+// makes the lists exactly large enough for the tiles of a droplet target of
+// width x height, the render size rather than the image size, so a large
+// image does not cost more than the window
+void dropletTilesResize(DropletTiles* p_tiles, int32_t width, int32_t height);
+// runs the classification compute shader for a target of the given size,
+// which has to match the resolution in the Frame uniforms
+void dropletTilesClassify(const Renderer& renderer, const DropletTiles& tiles, GLuint program, int32_t width, int32_t height);
+// lists every tile of a target of the given size as dry instead of
+// classifying them, for when nothing but the sprites draws droplets. The
+// lists only change with the size, so they are only uploaded then, and are
+// not classified in between.
+void dropletTilesFillDry(DropletTiles* p_tiles, int32_t width, int32_t height);
+// draws the wet or dry tiles with the pipeline set, whose program has to use
+// the tile vertex shader
+void dropletTilesDraw(const Renderer& renderer, const DropletTiles& tiles, bool wet);
+void dropletTilesDeinit(DropletTiles* p_tiles);
@@ -0,0 +1,75 @@
+#version 430 core
+
+// DROPLET_TILE_SIZE, the Frame uniform block and dropletsCommon.h are
+// inserted after the #version line
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+struct DrawArraysIndirectCommand {
+    uint count;
+    uint instance_count;
+    uint first;
+    uint base_instance;
+};
+
+// wet tiles from the start of the list, dry ones from u_tile_count on
+layout(std430, binding = 0) buffer Tiles {
+    DrawArraysIndirectCommand wet_draw;
+    DrawArraysIndirectCommand dry_draw;
+    uint tiles[];
+};
+
+// Whether any droplet or trail of a layer can touch the uv rectangle. Within
+// its cell a droplet covers DROPLET_RADIUS around its centre and its trail
+// DROPLET_TRAIL_HALF_WIDTH to the sides of it, from the centre up, so
+// everything above DROPLET_RADIUS below the centre in that column is wet.
+bool layerWet(vec2 lo, vec2 hi, float time) {
+    const float EPSILON = 0.01;
+    const float half_width = max(DROPLET_RADIUS, DROPLET_TRAIL_HALF_WIDTH);
+    vec2 first = floor(lo * DROPLET_GRID);
+    vec2 last = floor(hi * DROPLET_GRID);
+    for (float y = first.y; y <= last.y; y++) {
+        for (float x = first.x; x <= last.x; x++) {
+            vec2 id = vec2(x, y);
+            vec2 drop = dropletPosition(id, time);
+
+            vec2 a = lo * DROPLET_GRID - id;
+            vec2 b = hi * DROPLET_GRID - id;
+            if (b.x >= drop.x - half_width - EPSILON
+                && a.x <= drop.x + half_width + EPSILON
+                && b.y >= drop.y - DROPLET_RADIUS - EPSILON
+            ) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void main() {
+    ivec2 tile = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 tile_grid = (u_resolution + DROPLET_TILE_SIZE - 1) / DROPLET_TILE_SIZE;
+    if (any(greaterThanEqual(tile, tile_grid))) return;
+
+    vec2 resolution = vec2(u_resolution);
+    vec2 margin = vec2(u_droplet_margin + 1.0) / resolution;
+    vec2 lo = imageUv(vec2(tile * DROPLET_TILE_SIZE) / resolution - margin);
+    vec2 hi = imageUv(vec2(min((tile + 1) * DROPLET_TILE_SIZE, u_resolution)) / resolution + margin);
+
+#if DROPLET_WET_GLASS
+    bool wet = wetGlassWet(lo, hi);
+#else
+    bool wet = false;
+    for (int i = 0; i < DROPLET_LAYERS && !wet; i++) {
+        float scale = dropletLayerScale(i);
+        wet = layerWet(lo * scale, hi * scale, dropletLayerTime(i, u_time));
+    }
+#endif
+
+    uint packed_tile = uint(tile.x) | (uint(tile.y) << 16);
+    if (wet) {
+        tiles[atomicAdd(wet_draw.instance_count, 1u)] = packed_tile;
+    } else {
+        tiles[u_tile_count + atomicAdd(dry_draw.instance_count, 1u)] = packed_tile;
+    }
+}
@@ -0,0 +1,200 @@
+// Shared by the droplet shaders, inserted after their #version line together
+// with the #defines of the quality (see DropletQuality) and the Frame uniform
+// block, the defaults below are the medium quality
+
+// Layers of droplets, each a bit larger and faster than the one before
+#ifndef DROPLET_LAYERS
+#define DROPLET_LAYERS 2
+#endif
+// Droplet cells of a layer per unit of uv
+#ifndef DROPLET_GRID
+#define DROPLET_GRID (vec2(6.0, 3.0) * 1.5)
+#endif
+// Blur what is seen through the droplets
+#ifndef DROPLET_BLUR
+#define DROPLET_BLUR 1
+#endif
+// Take the droplets from the wet glass simulation instead of the stateless
+// droplets below
+#ifndef DROPLET_WET_GLASS
+#define DROPLET_WET_GLASS 0
+#endif
+
+// The offscreen targets only hold the part of the image in u_view, so a uv of
+// the target is turned into one of the whole image for anything anchored to
+// the glass
+vec2 imageUv(vec2 uv) {
+    return u_view.xy + uv * u_view.zw;
+}
+
+uniform sampler2D u_texture;
+uniform sampler2D u_rain; // premultiplied
+// blur pyramids of the layers, starting at half their size
+uniform sampler2D u_background_blur;
+uniform sampler2D u_rain_blur;
+
+// Rain over the background
+vec3 scene(vec2 uv) {
+    vec4 rain = texture(u_rain, uv);
+    return texture(u_texture, uv).rgb * (1.0 - rain.a) + rain.rgb;
+}
+
+float luma(vec3 color) {
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// The first level of the blur pyramids, blurred by DROPLET_BLUR_RADIUS, two
+// fetches whatever the radius
+vec3 blurredScene(vec2 uv) {
+#if DROPLET_BLUR
+    vec4 rain = textureLod(u_rain_blur, uv, 0.0);
+    return textureLod(u_background_blur, uv, 0.0).rgb * (1.0 - rain.a) + rain.rgb;
+#else
+    return scene(uv);
+#endif
+}
+
+float dropletLayerScale(int layer) {
+    return 1.0 + float(layer) * 0.15;
+}
+
+float dropletLayerTime(int layer, float time) {
+    return time * (1.0 + float(layer) * 0.2);
+}
+
+// Basic random function
+float rand(vec2 co) {
+    return fract(sin(dot(co, vec2(12.9898, 78.233))) * 43758.5453);
+}
+
+// Extent of the droplet of a cell and of its trail, in cells. The tile
+// classification bounds the droplets with them too.
+const float DROPLET_RADIUS = 0.1;
+const float DROPLET_TRAIL_HALF_WIDTH = 0.15;
+const float DROPLET_TRAIL_LENGTH = 0.3;
+
+// Centre of the droplet of the cell id within the cell
+vec2 dropletPosition(vec2 id, float time) {
+    // Random movement parameters
+    float speed = 0.5 + rand(id) * 0.5;
+    float xOffset = (rand(id * 1.37) - 0.5) * 0.3;
+    float startTime = rand(id * 2.45) * 10.0;
+
+    // Slight wiggle, and vertical movement with time
+    float wiggle = sin(time * 2.0 + id.x * 10.0) * 0.05;
+    float shift = mod(time * speed + startTime, 2.0) - 1.0;
+    return vec2(0.5 + xOffset + wiggle, 0.5 - shift);
+}
+
+// Create a single moving droplet with trail
+vec4 movingDroplet(vec2 uv, float time) {
+    vec2 grid = DROPLET_GRID;
+    vec2 id = floor(uv * grid);
+    vec2 st = fract(uv * grid);
+    vec2 dropPos = dropletPosition(id, time);
+
+    // Distance to droplet center
+    float dropDist = length(st - dropPos);
+
+    // Main droplet sharper
+    float drop = smoothstep(DROPLET_RADIUS, 0.0, dropDist);
+
+    // Trail (narrower and shorter)
+    float trail = smoothstep(DROPLET_TRAIL_HALF_WIDTH, 0.0, abs(st.x - dropPos.x)) *
+        smoothstep(0.0, DROPLET_TRAIL_LENGTH, st.y - dropPos.y);
+
+    return vec4(drop, trail, 0.0, 0.0);
+}
+
+// Distortion offset in rg, droplet strength in b
+vec4 dropletField(vec2 uv, float time) {
+    // Create moving droplets
+    vec4 droplets = vec4(0.0);
+    for (int i = 0; i < DROPLET_LAYERS; i++) {
+        droplets += movingDroplet(uv * dropletLayerScale(i), dropletLayerTime(i, time));
+    }
+
+    // Combine drop and trail
+    float dropletEffect = min(1.0, droplets.x * 0.8 + droplets.y * 0.5);
+
+    // Compute offset for distortion based on droplet center
+    vec2 offset = vec2(0.0);
+    if (dropletEffect > 0.0) {
+        vec2 center = vec2(0.5);
+        vec2 direction = normalize(uv - center);
+        offset = direction * dropletEffect * 0.07;
+    }
+
+    return vec4(offset, dropletEffect, 0.0);
+}
+
+#if DROPLET_WET_GLASS
+// water in r and wetness in g, see dropletsWetGlass.h
+uniform sampler2D u_wet_glass;
+
+// below this a texel of the simulation is dry
+const float WET_GLASS_DRY = 0.01;
+// distortion per unit of water slope
+const float WET_GLASS_REFRACTION = 0.08;
+
+// The water bends the view like a lens, along its slope, and wet glass blurs
+// it a little even where only a trail is left
+vec4 wetGlassField(vec2 uv) {
+    vec2 texel = 1.0 / vec2(textureSize(u_wet_glass, 0));
+    vec2 here = textureLod(u_wet_glass, uv, 0.0).rg;
+    float left = textureLod(u_wet_glass, uv - vec2(texel.x, 0.0), 0.0).r;
+    float right = textureLod(u_wet_glass, uv + vec2(texel.x, 0.0), 0.0).r;
+    float below = textureLod(u_wet_glass, uv - vec2(0.0, texel.y), 0.0).r;
+    float above = textureLod(u_wet_glass, uv + vec2(0.0, texel.y), 0.0).r;
+
+    vec2 slope = 0.5 * vec2(right - left, above - below);
+    float strength = clamp(here.r * 2.0 + here.g * 0.4, 0.0, 1.0);
+    return vec4(-slope * WET_GLASS_REFRACTION, strength, 0.0);
+}
+
+// Whether any water is close enough to the uv rectangle for wetGlassField to
+// see it, the bilinear fetch and the slope reach two texels around
+bool wetGlassWet(vec2 lo, vec2 hi) {
+    ivec2 size = textureSize(u_wet_glass, 0);
+    ivec2 first = max(ivec2(floor(lo * vec2(size))) - 2, ivec2(0));
+    ivec2 last = min(ivec2(floor(hi * vec2(size))) + 2, size - 1);
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++) {
+            vec2 state = texelFetch(u_wet_glass, ivec2(x, y), 0).rg;
+            if (state.r + state.g > WET_GLASS_DRY) return true;
+        }
+    }
+    return false;
+}
+#endif
+
+// Darken overall scene slightly and tint it slightly blue for rainy vibe
+vec3 rainyTint(vec3 color) {
+    return mix(color * 0.65, u_tint.rgb, u_tint.a);
+}
+
+// The scene as seen through the droplets, the field evaluated in uv of the
+// image
+vec3 dropletShade(vec2 uv, vec4 field) {
+    vec2 offset = field.rg / u_view.zw;
+    float dropletEffect = field.b;
+
+    // Apply UV distortion
+    vec2 distortedUV = uv + offset;
+
+    vec3 blurredColor = blurredScene(distortedUV);
+
+    // Fetch the sharp original texture
+    vec3 sharpColor = scene(distortedUV);
+
+    // Blend based on droplet strength
+    vec3 color = mix(sharpColor, blurredColor, dropletEffect);
+
+    color = rainyTint(color);
+
+    // Add inner highlight (fake specular light in droplet)
+    float highlight = smoothstep(0.08, 0.0, length(imageUv(uv) - vec2(0.5))) * dropletEffect * 0.8;
+    color += highlight;
+
+    return color;
+}
@@ -0,0 +1,53 @@
+#version 430 core
+
+layout(location = 0) in vec2 fragCoord;
+layout(location = 0) out vec4 fragColor;
+
+uniform sampler2D u_field;
+
+// Falloff of the range weight, higher keeps droplet edges sharper
+const float EDGE_SHARPNESS = 64.0;
+// Falloff of the guide weight, higher keeps edges of the scene sharper
+const float GUIDE_SHARPNESS = 32.0;
+
+float rangeWeight(float difference, float sharpness) {
+    return exp(-difference * difference * sharpness);
+}
+
+// Joint bilateral upsampling of the low resolution field: the four nearest
+// texels are weighted bilinearly, by how close their strength is to the
+// interpolated one, so texels across a droplet edge do not bleed into it, and
+// by how close the luma of the scene they were evaluated over (in alpha) is
+// to the full resolution one of the pixel, so the distortion of one side of
+// an edge in the image does not smear over the other. Where no texel matches
+// the pixel (e.g. a rain streak thinner than a texel) it falls back to
+// bilinear.
+vec4 upsampleField(vec2 uv) {
+    ivec2 size = textureSize(u_field, 0);
+    vec2 p = uv * vec2(size) - 0.5;
+    ivec2 base = ivec2(floor(p));
+    vec2 f = fract(p);
+
+    vec4 t00 = texelFetch(u_field, clamp(base, ivec2(0), size - 1), 0);
+    vec4 t10 = texelFetch(u_field, clamp(base + ivec2(1, 0), ivec2(0), size - 1), 0);
+    vec4 t01 = texelFetch(u_field, clamp(base + ivec2(0, 1), ivec2(0), size - 1), 0);
+    vec4 t11 = texelFetch(u_field, clamp(base + ivec2(1, 1), ivec2(0), size - 1), 0);
+
+    vec4 bilinear = mix(mix(t00, t10, f.x), mix(t01, t11, f.x), f.y);
+    float strength = bilinear.b;
+    float guide = luma(scene(uv));
+
+    float w00 = (1.0 - f.x) * (1.0 - f.y) * rangeWeight(t00.b - strength, EDGE_SHARPNESS) * rangeWeight(t00.a - guide, GUIDE_SHARPNESS);
+    float w10 = f.x * (1.0 - f.y) * rangeWeight(t10.b - strength, EDGE_SHARPNESS) * rangeWeight(t10.a - guide, GUIDE_SHARPNESS);
+    float w01 = (1.0 - f.x) * f.y * rangeWeight(t01.b - strength, EDGE_SHARPNESS) * rangeWeight(t01.a - guide, GUIDE_SHARPNESS);
+    float w11 = f.x * f.y * rangeWeight(t11.b - strength, EDGE_SHARPNESS) * rangeWeight(t11.a - guide, GUIDE_SHARPNESS);
+
+    float total = w00 + w10 + w01 + w11;
+    if (total < 1e-4) return bilinear;
+    return (t00 * w00 + t10 * w10 + t01 * w01 + t11 * w11) / total;
+}
+
+void main() {
+    vec2 uv = fragCoord;
+    fragColor = vec4(dropletShade(uv, upsampleField(uv)), 1.0);
+}
@@ -0,0 +1,9 @@
+#version 430 core
+
+layout(location = 0) in vec2 fragCoord;
+layout(location = 0) out vec4 fragColor;
+
+// Tiles without droplets, where the droplet shader comes down to this
+void main() {
+    fragColor = vec4(rainyTint(scene(fragCoord)), 1.0);
+}
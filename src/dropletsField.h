@@ -0,0 +1,25 @@
+#version 430 core
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(rgba16f, binding = 0) uniform writeonly image2D u_field;
+
+// The droplets are low frequency, so they are evaluated once per frame into a
+// field at a fraction of the resolution, which dropletsComposite.h upsamples.
+// With the wet glass simulation this turns its water into the field. The
+// luma of the scene under each texel goes in alpha, to guide the upsampling.
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(u_field);
+    if (any(greaterThanEqual(texel, size))) return;
+
+    vec2 target_uv = (vec2(texel) + 0.5) / vec2(size);
+    vec2 uv = imageUv(target_uv);
+#if DROPLET_WET_GLASS
+    vec4 field = wetGlassField(uv);
+#else
+    vec4 field = dropletField(uv, u_time);
+#endif
+    field.a = luma(scene(target_uv));
+    imageStore(u_field, texel, field);
+}
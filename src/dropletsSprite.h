@@ -0,0 +1,37 @@
+#version 430 core
+
+layout(location = 0) in vec2 fragCoord;
+layout(location = 1) in vec2 local;
+layout(location = 2) flat in vec2 radius;
+layout(location = 3) flat in float shape;
+layout(location = 0) out vec4 fragColor;
+
+// droplet shapes precomputed at startup: the xy of the normal in rg, the
+// thickness in b and the coverage in a, see DropletSprites
+uniform sampler2DArray u_droplet_atlas;
+
+// how far the droplet reaches for what it shows, in radii where its normal is
+// steepest, more than one turns the view upside down like a real droplet
+const float SPRITE_REFRACTION = 1.6;
+// share of the blurred scene seen through a droplet
+const float SPRITE_BLUR = 0.35;
+const vec3 SPRITE_LIGHT = normalize(vec3(-0.4, 0.5, 1.0));
+
+// A droplet of the CPU simulation, its shape looked up in the atlas: the view
+// is bent along the normal and darkens towards the thin rim, and the atlas
+// mips keep the edge of even the smallest droplets smooth
+void main() {
+    vec4 texel = texture(u_droplet_atlas, vec3(local * 0.5 + 0.5, shape));
+    if (texel.a <= 0.0) discard;
+
+    vec2 normal = texel.rg * 2.0 - 1.0;
+    float thickness = texel.b;
+    vec2 uv = fragCoord - normal * radius * SPRITE_REFRACTION;
+    vec3 color = mix(scene(uv), blurredScene(uv), SPRITE_BLUR);
+    color = rainyTint(color) * mix(0.7, 1.0, thickness);
+
+    vec3 n = vec3(normal, sqrt(max(1.0 - dot(normal, normal), 0.0)));
+    color += 0.4 * pow(max(dot(n, SPRITE_LIGHT), 0.0), 24.0);
+
+    fragColor = vec4(color, texel.a);
+}
@@ -0,0 +1,42 @@
+#version 430 core
+
+// The Frame uniform block is inserted after the #version line
+
+// uv of the centre, radius in uv of the image height and atlas layer of
+// every droplet, see DropletSprite
+layout(std430, binding = 1) readonly buffer Sprites {
+    vec4 sprites[];
+};
+
+layout(location = 0) out vec2 fragCoord;
+// position within the droplet, its edge at length 1
+layout(location = 1) out vec2 local;
+layout(location = 2) flat out vec2 radius;
+layout(location = 3) flat out float shape;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// One quad per droplet, a pixel larger than it for the anti-aliased edge.
+// The sprites are placed on the whole image, of which the target may only
+// hold the part in u_view, the droplets outside it are clipped. Drawn onto the
+// window, the quads go where the screen shader puts the image.
+void main() {
+    vec4 sprite = sprites[gl_InstanceID];
+    float aspect = float(u_resolution.x) * u_view.w / (float(u_resolution.y) * u_view.z);
+    float extent = sprite.z + u_view.w / float(u_resolution.y);
+    vec2 corner = CORNERS[gl_VertexID];
+
+    radius = vec2(sprite.z / aspect, sprite.z) / u_view.zw;
+    shape = sprite.w;
+    local = corner * extent / sprite.z;
+    vec2 image = sprite.xy + corner * vec2(extent / aspect, extent);
+    fragCoord = (image - u_view.xy) / u_view.zw;
+    vec2 pos = fragCoord * 2.0 - 1.0;
+    if (u_droplet_to_window != 0u) {
+        pos = u_scale * (image * 2.0 - 1.0) * vec2(0.5 * aspect, 0.5) + u_cam_pos;
+    }
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
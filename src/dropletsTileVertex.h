@@ -0,0 +1,36 @@
+#version 430 core
+
+// DROPLET_TILE_SIZE and the Frame uniform block are inserted after the
+// #version line
+
+layout(std430, binding = 0) readonly buffer Tiles {
+    uvec4 draws[2];
+    uint tiles[];
+};
+
+layout(location = 0) out vec2 fragCoord;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+// One instance per classified tile, clipped to the target. The dry tiles are
+// drawn starting at vertex 6, which picks the second list. Drawn onto the
+// window, the tiles go where the screen shader puts the part of the image
+// quad the target holds.
+void main() {
+    uint list = uint(gl_VertexID / 6);
+    uint packed_tile = tiles[list * u_tile_count + uint(gl_InstanceID)];
+    vec2 tile = vec2(packed_tile & 0xffffu, packed_tile >> 16);
+    vec2 pixel = min((tile + CORNERS[gl_VertexID % 6]) * float(DROPLET_TILE_SIZE), vec2(u_resolution));
+
+    fragCoord = pixel / vec2(u_resolution);
+    vec2 pos = fragCoord * 2.0 - 1.0;
+    if (u_droplet_to_window != 0u) {
+        vec2 image = (u_view.xy + fragCoord * u_view.zw) * 2.0 - 1.0;
+        float aspect = float(u_resolution.x) * u_view.w / (float(u_resolution.y) * u_view.z);
+        pos = u_scale * image * vec2(0.5 * aspect, 0.5) + u_cam_pos;
+    }
+    gl_Position = vec4(pos, 0.0, 1.0);
+}
@@ -0,0 +1,84 @@
+#version 430 core
+
+// The #defines of the quality and the Frame uniform block are inserted after
+// the #version line
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// water in r, wetness left behind in g
+uniform sampler2D u_wet_glass;
+layout(rgba16f, binding = 0) uniform writeonly image2D u_next;
+uniform uint u_step;
+
+// chance of a droplet condensing on a texel per step, and its size range
+const float CONDENSATION = 0.00008;
+const vec2 CONDENSED_WATER = vec2(0.15, 0.6);
+// water a texel holds before it runs down, leaving a little behind
+const float RUN_THRESHOLD = 0.7;
+const float RESIDUE = 0.05;
+// steps running water keeps to its direction before it may swerve
+const uint SWERVE_STEPS = 12u;
+// water a texel keeps per step, the rest evaporates
+const float EVAPORATION = 0.9997;
+const float WETNESS_FADE = 0.996;
+
+uint hash(uvec3 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    v ^= v >> 16u;
+    v.x += v.y * v.z;
+    v.y += v.z * v.x;
+    v.z += v.x * v.y;
+    return v.x;
+}
+
+float random(uvec3 v) {
+    return float(hash(v) >> 8u) / 16777216.0;
+}
+
+// water running out of the texel this step
+float running(ivec2 texel) {
+    float water = texelFetch(u_wet_glass, texel, 0).r;
+    return water > RUN_THRESHOLD ? water - RESIDUE : 0.0;
+}
+
+// column the water of the texel runs down into, mostly straight down and
+// the same for a while in each column so runs look like paths
+int runsInto(ivec2 texel, int width) {
+    float r = random(uvec3(uint(texel.x), u_step / SWERVE_STEPS, 7u));
+    int dx = r < 0.1 ? -1 : (r > 0.9 ? 1 : 0);
+    return clamp(texel.x + dx, 0, width - 1);
+}
+
+// Every texel gathers what runs into it from the three above it, so water is
+// moved without atomics. Besides what runs off the bottom, water is only lost
+// to evaporation, a small fraction of every texel each step, so a droplet
+// that never runs loses half its water in about 40 seconds. Droplets landing
+// on each other or in the path of running water merge into it, and grow
+// heavy enough to run themselves.
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = textureSize(u_wet_glass, 0);
+    if (any(greaterThanEqual(texel, size))) return;
+
+    vec4 state = texelFetch(u_wet_glass, texel, 0);
+    float water = state.r - running(texel);
+    if (texel.y + 1 < size.y) {
+        for (int dx = -1; dx <= 1; dx++) {
+            ivec2 above = ivec2(texel.x + dx, texel.y + 1);
+            if (above.x < 0 || above.x >= size.x) continue;
+            if (runsInto(above, size.x) == texel.x) water += running(above);
+        }
+    }
+
+    uvec3 seed = uvec3(uvec2(texel), u_step);
+    if (random(seed) < CONDENSATION) {
+        water += mix(CONDENSED_WATER.x, CONDENSED_WATER.y, random(seed + uvec3(0u, 0u, 0x9e3779b9u)));
+    }
+    water *= EVAPORATION;
+
+    float wetness = max(state.g * WETNESS_FADE, min(water * 2.0, 1.0));
+    imageStore(u_next, texel, vec4(water, wetness, 0.0, 0.0));
+}
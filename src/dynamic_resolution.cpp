@@ -0,0 +1,104 @@
+#include "dynamic_resolution.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <print>
+
+// frames to wait after a change before changing again, so freshly allocated
+// targets get measured and we do not reallocate every frame
+const uint32_t SETTLE_FRAMES = 30;
+// only scale up when comfortably under budget, only scale down when over it
+const float UPSCALE_THRESHOLD = 0.7;
+const float DOWNSCALE_THRESHOLD = 1.0;
+// ignore changes smaller than this
+const float MIN_SCALE_STEP = 0.05;
+const float GPU_MS_SMOOTHING = 0.1;
+
+std::optional<DynamicResolution> dynamicResolutionInit(float target_fps, float min_scale, float max_scale) {
+    DynamicResolution dynres = {
+        .budget_ms = target_fps > 0.0f ? 1000.0f / target_fps : 0.0f,
+        .min_scale = min_scale,
+        .max_scale = max_scale,
+        .scale = max_scale,
+        .gpu_ms = 0.0,
+        .frames_since_change = 0,
+    };
+    glGenQueries(DYNAMIC_RESOLUTION_QUERIES, dynres.queries);
+    for (uint32_t i = 0; i < DYNAMIC_RESOLUTION_QUERIES; i++) {
+        if (dynres.queries[i] == 0) {
+            std::println("ERR: Failed to create GPU timer queries");
+            return std::nullopt;
+        }
+        dynres.query_pending[i] = false;
+    }
+    dynres.query_index = 0;
+
+    return dynres;
+}
+
+void dynamicResolutionBegin(DynamicResolution* p_dynres) {
+    // a query still in flight from DYNAMIC_RESOLUTION_QUERIES frames ago means
+    // the GPU is far behind, skip measuring rather than stall on it
+    if (p_dynres->query_pending[p_dynres->query_index]) return;
+    glBeginQuery(GL_TIME_ELAPSED, p_dynres->queries[p_dynres->query_index]);
+}
+
+void dynamicResolutionEnd(DynamicResolution* p_dynres) {
+    const uint32_t index = p_dynres->query_index;
+    if (!p_dynres->query_pending[index]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        p_dynres->query_pending[index] = true;
+    }
+    p_dynres->query_index = (index + 1) % DYNAMIC_RESOLUTION_QUERIES;
+}
+
+bool dynamicResolutionUpdate(DynamicResolution* p_dynres) {
+    // collect finished queries without waiting on them
+    for (uint32_t i = 0; i < DYNAMIC_RESOLUTION_QUERIES; i++) {
+        if (!p_dynres->query_pending[i]) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(p_dynres->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(p_dynres->queries[i], GL_QUERY_RESULT, &ns);
+        p_dynres->query_pending[i] = false;
+
+        const float ms = float(ns) / 1000000.0f;
+        p_dynres->gpu_ms = p_dynres->gpu_ms == 0.0f ? ms : std::lerp(p_dynres->gpu_ms, ms, GPU_MS_SMOOTHING);
+    }
+
+    p_dynres->frames_since_change += 1;
+    if (p_dynres->budget_ms == 0.0f || p_dynres->gpu_ms == 0.0f) return false;
+    if (p_dynres->frames_since_change < SETTLE_FRAMES) return false;
+
+    const float load = p_dynres->gpu_ms / p_dynres->budget_ms;
+    if (load < DOWNSCALE_THRESHOLD && load > UPSCALE_THRESHOLD) return false;
+
+    // GPU time goes with the pixel count, i.e. with the square of the scale,
+    // aim for the middle of the band
+    const float target_load = (UPSCALE_THRESHOLD + DOWNSCALE_THRESHOLD) / 2.0f;
+    const float scale = std::clamp(
+        p_dynres->scale * std::sqrt(target_load / load),
+        p_dynres->min_scale,
+        p_dynres->max_scale
+    );
+    if (std::abs(scale - p_dynres->scale) < MIN_SCALE_STEP) return false;
+
+    std::println("INFO: Render scale {:.2f} -> {:.2f} ({:.2f}ms GPU, {:.2f}ms budget)", p_dynres->scale, scale, p_dynres->gpu_ms, p_dynres->budget_ms);
+    p_dynres->scale = scale;
+    p_dynres->frames_since_change = 0;
+    return true;
+}
+
+void dynamicResolutionDeinit(DynamicResolution* p_dynres) {
+    glDeleteQueries(DYNAMIC_RESOLUTION_QUERIES, p_dynres->queries);
+    for (uint32_t i = 0; i < DYNAMIC_RESOLUTION_QUERIES; i++) {
+        p_dynres->queries[i] = 0;
+        p_dynres->query_pending[i] = false;
+    }
+}
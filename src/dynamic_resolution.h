@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <optional>
+
+#define DYNAMIC_RESOLUTION_QUERIES 4
+
+// Scales the offscreen render targets so the GPU time of a frame stays
+// within the budget of the target FPS.
+struct DynamicResolution {
+    float budget_ms;
+    float min_scale;
+    float max_scale;
+    float scale;
+    // exponential moving average of the measured GPU time
+    float gpu_ms;
+    uint32_t frames_since_change;
+
+    GLuint queries[DYNAMIC_RESOLUTION_QUERIES];
+    bool query_pending[DYNAMIC_RESOLUTION_QUERIES];
+    uint32_t query_index;
+};
+
+// target_fps of 0 keeps the scale fixed at max_scale
+std::optional<DynamicResolution> dynamicResolutionInit(float target_fps, float min_scale, float max_scale);
+void dynamicResolutionBegin(DynamicResolution* p_dynres);
+void dynamicResolutionEnd(DynamicResolution* p_dynres);
+// returns true when the scale changed
+bool dynamicResolutionUpdate(DynamicResolution* p_dynres);
+void dynamicResolutionDeinit(DynamicResolution* p_dynres);
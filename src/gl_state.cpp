@@ -0,0 +1,166 @@
+#include "gl_state.h"
+
+#include <glad/gl.h>
+
+#include <cstdint>
+
+// never a GL name or enum value, so the first change after an invalidate
+// always goes through
+const GLuint UNKNOWN = 0xffffffff;
+
+struct GlState {
+    GLuint program;
+    GLuint vert_arr;
+    GLuint draw_framebuffer;
+    GLuint read_framebuffer;
+    GLuint active_unit;
+    GLuint textures[GL_STATE_TEXTURE_UNITS];
+    GLuint blend;
+    GLenum blend_func[4];
+    GLint viewport[4];
+    GlStateStats stats;
+};
+
+bool changeState(GLuint* p_current, GLuint value);
+
+const GlState UNKNOWN_STATE = {
+    .program = UNKNOWN,
+    .vert_arr = UNKNOWN,
+    .draw_framebuffer = UNKNOWN,
+    .read_framebuffer = UNKNOWN,
+    .active_unit = UNKNOWN,
+    .textures = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN },
+    .blend = UNKNOWN,
+    .blend_func = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN },
+    .viewport = { -1, -1, -1, -1 },
+    .stats = {},
+};
+
+GlState g_state = UNKNOWN_STATE;
+
+// updates the tracked value, returns false when it already was current
+bool changeState(GLuint* p_current, GLuint value) {
+    if (*p_current == value) {
+        g_state.stats.redundant += 1;
+        return false;
+    }
+    *p_current = value;
+    g_state.stats.changes += 1;
+    return true;
+}
+
+void glStateUseProgram(GLuint program) {
+    if (changeState(&g_state.program, program)) glUseProgram(program);
+}
+
+void glStateBindVertexArray(GLuint vert_arr) {
+    if (changeState(&g_state.vert_arr, vert_arr)) glBindVertexArray(vert_arr);
+}
+
+void glStateBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_FRAMEBUFFER) {
+        if (g_state.draw_framebuffer == framebuffer && g_state.read_framebuffer == framebuffer) {
+            g_state.stats.redundant += 1;
+            return;
+        }
+        g_state.draw_framebuffer = framebuffer;
+        g_state.read_framebuffer = framebuffer;
+        g_state.stats.changes += 1;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    } else if (changeState(target == GL_DRAW_FRAMEBUFFER ? &g_state.draw_framebuffer : &g_state.read_framebuffer, framebuffer)) {
+        glBindFramebuffer(target, framebuffer);
+    }
+}
+
+void glStateBindTexture(GLuint unit, GLuint texture, GLenum target) {
+    const bool tracked = target == GL_TEXTURE_2D && unit < GL_STATE_TEXTURE_UNITS;
+    // the unit is made active even if the binding is redundant, since the
+    // caller may go on to edit the texture through it
+    if (changeState(&g_state.active_unit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+    if (tracked && g_state.textures[unit] == texture) {
+        g_state.stats.redundant += 1;
+        return;
+    }
+    if (tracked) g_state.textures[unit] = texture;
+    g_state.stats.changes += 1;
+    glBindTexture(target, texture);
+}
+
+void glStateBlend(bool enabled) {
+    if (!changeState(&g_state.blend, enabled)) return;
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+}
+
+void glStateBlendFunc(GLenum src, GLenum dst) {
+    glStateBlendFuncSeparate(src, dst, src, dst);
+}
+
+void glStateBlendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    const GLenum func[4] = { src_rgb, dst_rgb, src_alpha, dst_alpha };
+    bool same = true;
+    for (int i = 0; i < 4; i++) {
+        if (g_state.blend_func[i] != func[i]) same = false;
+        g_state.blend_func[i] = func[i];
+    }
+    if (same) {
+        g_state.stats.redundant += 1;
+        return;
+    }
+    g_state.stats.changes += 1;
+    glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+}
+
+void glStateViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    const GLint viewport[4] = { x, y, width, height };
+    bool same = true;
+    for (int i = 0; i < 4; i++) {
+        if (g_state.viewport[i] != viewport[i]) same = false;
+        g_state.viewport[i] = viewport[i];
+    }
+    if (same) {
+        g_state.stats.redundant += 1;
+        return;
+    }
+    g_state.stats.changes += 1;
+    glViewport(x, y, width, height);
+}
+
+void glStateDeleteTextures(GLsizei count, const GLuint* textures) {
+    for (GLsizei i = 0; i < count; i++) {
+        for (GLuint& bound : g_state.textures) {
+            if (bound == textures[i]) bound = 0;
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void glStateDeleteFramebuffers(GLsizei count, const GLuint* framebuffers) {
+    for (GLsizei i = 0; i < count; i++) {
+        if (g_state.draw_framebuffer == framebuffers[i]) g_state.draw_framebuffer = 0;
+        if (g_state.read_framebuffer == framebuffers[i]) g_state.read_framebuffer = 0;
+    }
+    glDeleteFramebuffers(count, framebuffers);
+}
+
+void glStateDeleteVertexArrays(GLsizei count, const GLuint* vert_arrs) {
+    for (GLsizei i = 0; i < count; i++) {
+        if (g_state.vert_arr == vert_arrs[i]) g_state.vert_arr = 0;
+    }
+    glDeleteVertexArrays(count, vert_arrs);
+}
+
+void glStateInvalidate() {
+    const GlStateStats stats = g_state.stats;
+    g_state = UNKNOWN_STATE;
+    g_state.stats = stats;
+}
+
+GlStateStats glStateEndFrame() {
+    const GlStateStats stats = g_state.stats;
+    g_state.stats = {};
+    return stats;
+}
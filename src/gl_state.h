@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+
+// texture units whose GL_TEXTURE_2D binding is tracked, binds to higher
+// units always go through
+#define GL_STATE_TEXTURE_UNITS 8
+
+// Tracks the state the renderer changes most (program, vertex array,
+// framebuffers, 2D texture bindings, blending and viewport) and drops
+// changes to a value that is already current. Everything in src/ changes
+// these through here, and deletes textures, framebuffers and vertex arrays
+// through here too since GL unbinds them on delete. The tracker is global
+// like the GL context it mirrors.
+struct GlStateStats {
+    // changes that reached GL
+    uint32_t changes;
+    // changes dropped because the value was already current
+    uint32_t redundant;
+};
+
+void glStateUseProgram(GLuint program);
+void glStateBindVertexArray(GLuint vert_arr);
+// GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+void glStateBindFramebuffer(GLenum target, GLuint framebuffer);
+// leaves the unit active even when the binding is already current, so glTex*
+// calls after it edit the texture, only GL_TEXTURE_2D bindings are tracked
+void glStateBindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+void glStateBlend(bool enabled);
+void glStateBlendFunc(GLenum src, GLenum dst);
+void glStateBlendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+void glStateViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void glStateDeleteTextures(GLsizei count, const GLuint* textures);
+void glStateDeleteFramebuffers(GLsizei count, const GLuint* framebuffers);
+void glStateDeleteVertexArrays(GLsizei count, const GLuint* vert_arrs);
+// forgets the tracked state, for code changing it behind the tracker's back
+// (e.g. the ImGui renderer)
+void glStateInvalidate();
+// the counts since the last call
+GlStateStats glStateEndFrame();
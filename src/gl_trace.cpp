@@ -0,0 +1,309 @@
+#include "gl_trace.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <numeric>
+#include <print>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// every entry point src/ calls
+#define GL_TRACE_CALLS(X) \
+    X(glActiveTexture) X(glAttachShader) X(glBeginQuery) X(glBindBuffer) \
+    X(glBindBufferBase) X(glBindFramebuffer) X(glBindImageTexture) X(glBindRenderbuffer) \
+    X(glBindTexture) X(glBindVertexArray) X(glBlendFuncSeparate) X(glBlitFramebuffer) \
+    X(glBufferData) X(glBufferSubData) X(glCheckFramebufferStatus) X(glCheckNamedFramebufferStatus) \
+    X(glClear) X(glClearColor) X(glClearStencil) X(glCompileShader) X(glCreateBuffers) \
+    X(glCreateFramebuffers) X(glCreateProgram) X(glCreateShader) X(glCreateTextures) \
+    X(glCreateVertexArrays) X(glDeleteBuffers) X(glDeleteFramebuffers) X(glDeleteProgram) \
+    X(glDeleteQueries) X(glDeleteRenderbuffers) X(glDeleteShader) X(glDeleteTextures) \
+    X(glDeleteVertexArrays) X(glDisable) X(glDispatchCompute) X(glDrawArrays) \
+    X(glDrawArraysIndirect) X(glDrawArraysInstanced) X(glDrawBuffers) X(glDrawElements) X(glEnable) \
+    X(glEnableVertexArrayAttrib) X(glEnableVertexAttribArray) X(glEndQuery) X(glFramebufferRenderbuffer) \
+    X(glFramebufferTexture) X(glGenBuffers) X(glGenFramebuffers) X(glGenQueries) \
+    X(glGenRenderbuffers) X(glGenTextures) X(glGenVertexArrays) X(glGenerateMipmap) \
+    X(glGenerateTextureMipmap) X(glGetIntegerv) X(glGetProgramInfoLog) X(glGetProgramInterfaceiv) \
+    X(glGetProgramResourceName) X(glGetProgramResourceiv) X(glGetProgramiv) X(glGetQueryObjectiv) \
+    X(glGetQueryObjectui64v) X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) \
+    X(glGetUniformLocation) X(glLinkProgram) X(glMemoryBarrier) X(glNamedBufferStorage) \
+    X(glNamedBufferSubData) X(glNamedFramebufferDrawBuffers) X(glNamedFramebufferTexture) X(glProgramUniform1i) \
+    X(glReadPixels) X(glRenderbufferStorageMultisample) X(glShaderSource) X(glStencilFunc) X(glStencilOp) X(glTexImage2D) \
+    X(glTexParameteri) X(glTexStorage2D) X(glTexSubImage2D) X(glTextureParameteri) \
+    X(glTextureStorage2D) X(glTextureSubImage2D) X(glUniform1i) X(glUniform2fv) \
+    X(glUniform2iv) X(glUniform1f) X(glUniform2i) X(glUniform1ui) X(glTexStorage3D) \
+    X(glTexSubImage3D) X(glTextureStorage3D) X(glTextureSubImage3D) X(glUseProgram) X(glVertexArrayAttribBinding) X(glVertexArrayAttribFormat) \
+    X(glVertexArrayElementBuffer) X(glVertexArrayVertexBuffer) X(glVertexAttribPointer) X(glViewport)
+
+enum GlTraceCall {
+#define GL_TRACE_ENUM(name) GL_TRACE_##name,
+    GL_TRACE_CALLS(GL_TRACE_ENUM)
+#undef GL_TRACE_ENUM
+    GL_TRACE_CALL_COUNT,
+};
+
+#define GL_TRACE_NAME(name) #name,
+const char* const CALL_NAMES[GL_TRACE_CALL_COUNT] = { GL_TRACE_CALLS(GL_TRACE_NAME) };
+#undef GL_TRACE_NAME
+
+struct GlTrace {
+    GlTraceFrame frame;
+    GlTraceFrame last;
+    // a ring of the last GL_TRACE_HISTORY frames, frame_count % its size is
+    // the oldest once it is full
+    std::vector<GlTraceFrame> history;
+    uint64_t frame_count;
+    // of every frame
+    uint64_t calls;
+    uint64_t sync_calls;
+    uint64_t uploaded_bytes;
+    uint64_t read_back_bytes;
+    std::vector<uint64_t> totals;
+    bool syncs[GL_TRACE_CALL_COUNT];
+    // with a pixel buffer bound the pixel pointers are offsets into it and
+    // nothing moves through client memory
+    GLuint pack_buffer;
+    GLuint unpack_buffer;
+};
+
+GlTrace g_trace = {};
+
+void countCall(GlTraceCall call);
+void recordUpload(GlTraceCall call, uint64_t bytes);
+uint64_t pixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type);
+
+// forwards to the function glad loaded, counting the call on the way
+template <GlTraceCall CALL, typename Proc> struct Traced;
+template <GlTraceCall CALL, typename R, typename... Args>
+struct Traced<CALL, R (GLAD_API_PTR*)(Args...)> {
+    static inline R (GLAD_API_PTR* real)(Args...) = NULL;
+
+    static R GLAD_API_PTR call(Args... args) {
+        countCall(CALL);
+        return real(args...);
+    }
+};
+
+#define GL_TRACE_REAL(name) Traced<GL_TRACE_##name, decltype(glad_##name)>::real
+
+// the calls moving data or tracking the pixel buffer bindings, counted and
+// forwarded like the rest
+
+void GLAD_API_PTR tracedBindBuffer(GLenum target, GLuint buffer) {
+    countCall(GL_TRACE_glBindBuffer);
+    if (target == GL_PIXEL_PACK_BUFFER) g_trace.pack_buffer = buffer;
+    if (target == GL_PIXEL_UNPACK_BUFFER) g_trace.unpack_buffer = buffer;
+    GL_TRACE_REAL(glBindBuffer)(target, buffer);
+}
+
+void GLAD_API_PTR tracedBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    countCall(GL_TRACE_glBufferData);
+    if (data != NULL) recordUpload(GL_TRACE_glBufferData, size);
+    GL_TRACE_REAL(glBufferData)(target, size, data, usage);
+}
+
+void GLAD_API_PTR tracedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    countCall(GL_TRACE_glBufferSubData);
+    recordUpload(GL_TRACE_glBufferSubData, size);
+    GL_TRACE_REAL(glBufferSubData)(target, offset, size, data);
+}
+
+void GLAD_API_PTR tracedNamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags) {
+    countCall(GL_TRACE_glNamedBufferStorage);
+    if (data != NULL) recordUpload(GL_TRACE_glNamedBufferStorage, size);
+    GL_TRACE_REAL(glNamedBufferStorage)(buffer, size, data, flags);
+}
+
+void GLAD_API_PTR tracedNamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) {
+    countCall(GL_TRACE_glNamedBufferSubData);
+    recordUpload(GL_TRACE_glNamedBufferSubData, size);
+    GL_TRACE_REAL(glNamedBufferSubData)(buffer, offset, size, data);
+}
+
+void GLAD_API_PTR tracedTexImage2D(
+    GLenum target, GLint level, GLint internal_format, GLsizei width, GLsizei height, GLint border,
+    GLenum format, GLenum type, const void* pixels
+) {
+    countCall(GL_TRACE_glTexImage2D);
+    if (pixels != NULL && g_trace.unpack_buffer == 0) {
+        recordUpload(GL_TRACE_glTexImage2D, pixelBytes(width, height, format, type));
+    }
+    GL_TRACE_REAL(glTexImage2D)(target, level, internal_format, width, height, border, format, type, pixels);
+}
+
+void GLAD_API_PTR tracedTexSubImage2D(
+    GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* pixels
+) {
+    countCall(GL_TRACE_glTexSubImage2D);
+    if (g_trace.unpack_buffer == 0) recordUpload(GL_TRACE_glTexSubImage2D, pixelBytes(width, height, format, type));
+    GL_TRACE_REAL(glTexSubImage2D)(target, level, x, y, width, height, format, type, pixels);
+}
+
+void GLAD_API_PTR tracedTextureSubImage2D(
+    GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* pixels
+) {
+    countCall(GL_TRACE_glTextureSubImage2D);
+    if (g_trace.unpack_buffer == 0) recordUpload(GL_TRACE_glTextureSubImage2D, pixelBytes(width, height, format, type));
+    GL_TRACE_REAL(glTextureSubImage2D)(texture, level, x, y, width, height, format, type, pixels);
+}
+
+void GLAD_API_PTR tracedTexSubImage3D(
+    GLenum target, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth,
+    GLenum format, GLenum type, const void* pixels
+) {
+    countCall(GL_TRACE_glTexSubImage3D);
+    if (g_trace.unpack_buffer == 0) recordUpload(GL_TRACE_glTexSubImage3D, depth * pixelBytes(width, height, format, type));
+    GL_TRACE_REAL(glTexSubImage3D)(target, level, x, y, z, width, height, depth, format, type, pixels);
+}
+
+void GLAD_API_PTR tracedTextureSubImage3D(
+    GLuint texture, GLint level, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth,
+    GLenum format, GLenum type, const void* pixels
+) {
+    countCall(GL_TRACE_glTextureSubImage3D);
+    if (g_trace.unpack_buffer == 0) recordUpload(GL_TRACE_glTextureSubImage3D, depth * pixelBytes(width, height, format, type));
+    GL_TRACE_REAL(glTextureSubImage3D)(texture, level, x, y, z, width, height, depth, format, type, pixels);
+}
+
+// waits for the rendering it reads unless it goes into a pixel buffer
+void GLAD_API_PTR tracedReadPixels(
+    GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels
+) {
+    countCall(GL_TRACE_glReadPixels);
+    if (g_trace.pack_buffer == 0) {
+        g_trace.frame.sync_calls += 1;
+        g_trace.frame.read_back_bytes += pixelBytes(width, height, format, type);
+    }
+    GL_TRACE_REAL(glReadPixels)(x, y, width, height, format, type, pixels);
+}
+
+void glTraceInit() {
+    g_trace.frame.counts.assign(GL_TRACE_CALL_COUNT, 0);
+    g_trace.last.counts.assign(GL_TRACE_CALL_COUNT, 0);
+    g_trace.totals.assign(GL_TRACE_CALL_COUNT, 0);
+    g_trace.history.reserve(GL_TRACE_HISTORY);
+    for (size_t i = 0; i < GL_TRACE_CALL_COUNT; i++) {
+        g_trace.syncs[i] = std::string_view(CALL_NAMES[i]).starts_with("glGet");
+    }
+
+#define GL_TRACE_WRAP(name) \
+    Traced<GL_TRACE_##name, decltype(glad_##name)>::real = glad_##name; \
+    glad_##name = Traced<GL_TRACE_##name, decltype(glad_##name)>::call;
+    GL_TRACE_CALLS(GL_TRACE_WRAP)
+#undef GL_TRACE_WRAP
+
+    glad_glBindBuffer = tracedBindBuffer;
+    glad_glBufferData = tracedBufferData;
+    glad_glBufferSubData = tracedBufferSubData;
+    glad_glNamedBufferStorage = tracedNamedBufferStorage;
+    glad_glNamedBufferSubData = tracedNamedBufferSubData;
+    glad_glTexImage2D = tracedTexImage2D;
+    glad_glTexSubImage2D = tracedTexSubImage2D;
+    glad_glTextureSubImage2D = tracedTextureSubImage2D;
+    glad_glTexSubImage3D = tracedTexSubImage3D;
+    glad_glTextureSubImage3D = tracedTextureSubImage3D;
+    glad_glReadPixels = tracedReadPixels;
+
+    std::println("INFO: tracing {} GL entry points", size_t(GL_TRACE_CALL_COUNT));
+}
+
+void countCall(GlTraceCall call) {
+    g_trace.frame.calls += 1;
+    g_trace.frame.counts[call] += 1;
+    if (g_trace.syncs[call]) g_trace.frame.sync_calls += 1;
+}
+
+void recordUpload(GlTraceCall call, uint64_t bytes) {
+    g_trace.frame.uploaded_bytes += bytes;
+    if (bytes > g_trace.frame.largest_upload) {
+        g_trace.frame.largest_upload = bytes;
+        g_trace.frame.largest_upload_call = CALL_NAMES[call];
+    }
+}
+
+// ignores the unpack alignment, close enough for the formats used here
+uint64_t pixelBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    uint64_t components = 4;
+    switch (format) {
+        case GL_RED: case GL_RED_INTEGER: case GL_STENCIL_INDEX: components = 1; break;
+        case GL_RG: case GL_RG_INTEGER: components = 2; break;
+        case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+    }
+    uint64_t component_bytes = 4;
+    switch (type) {
+        case GL_UNSIGNED_BYTE: case GL_BYTE: component_bytes = 1; break;
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: component_bytes = 2; break;
+    }
+    return uint64_t(width) * uint64_t(height) * components * component_bytes;
+}
+
+void glTraceEndFrame() {
+    for (size_t i = 0; i < GL_TRACE_CALL_COUNT; i++) g_trace.totals[i] += g_trace.frame.counts[i];
+
+    g_trace.calls += g_trace.frame.calls;
+    g_trace.sync_calls += g_trace.frame.sync_calls;
+    g_trace.uploaded_bytes += g_trace.frame.uploaded_bytes;
+    g_trace.read_back_bytes += g_trace.frame.read_back_bytes;
+
+    g_trace.last = g_trace.frame;
+    GlTraceFrame kept = g_trace.frame;
+    kept.counts.clear();
+    if (g_trace.history.size() < GL_TRACE_HISTORY) {
+        g_trace.history.push_back(kept);
+    } else {
+        g_trace.history[g_trace.frame_count % GL_TRACE_HISTORY] = kept;
+    }
+    g_trace.frame_count += 1;
+
+    g_trace.frame = {
+        .largest_upload_call = NULL,
+        .counts = std::vector<uint32_t>(GL_TRACE_CALL_COUNT, 0),
+    };
+}
+
+const GlTraceFrame& glTraceLastFrame() {
+    return g_trace.last;
+}
+
+const char* glTraceCallName(size_t call) {
+    return CALL_NAMES[call];
+}
+
+bool glTraceCallSyncs(size_t call) {
+    return call == GL_TRACE_glReadPixels || g_trace.syncs[call];
+}
+
+void glTraceDump(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::println("ERR: Failed to write the GL trace to {}", filename);
+        return;
+    }
+
+    std::println(file, "frames {} calls {} sync {} uploaded {} read back {}",
+        g_trace.frame_count, g_trace.calls, g_trace.sync_calls, g_trace.uploaded_bytes, g_trace.read_back_bytes);
+
+    std::println(file, "\ncalls per entry point (* waits for the GPU)");
+    std::vector<size_t> order(GL_TRACE_CALL_COUNT);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [](size_t a, size_t b) { return g_trace.totals[a] > g_trace.totals[b]; });
+    for (size_t call : order) {
+        if (g_trace.totals[call] == 0) break;
+        std::println(file, "{:>10} {}{}", g_trace.totals[call], CALL_NAMES[call], glTraceCallSyncs(call) ? " *" : "");
+    }
+
+    std::println(file, "\nframe calls sync uploaded read_back largest_upload");
+    const uint64_t first = g_trace.frame_count - g_trace.history.size();
+    for (uint64_t i = first; i < g_trace.frame_count; i++) {
+        const GlTraceFrame& frame = g_trace.history[i % GL_TRACE_HISTORY];
+        std::println(file, "{} {} {} {} {} {}{}{}", i, frame.calls, frame.sync_calls, frame.uploaded_bytes,
+            frame.read_back_bytes, frame.largest_upload,
+            frame.largest_upload_call ? " " : "", frame.largest_upload_call ? frame.largest_upload_call : "");
+    }
+    std::println("INFO: GL trace of {} frames written to {}", g_trace.frame_count, filename);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define GL_TRACE_FILE "gl_trace.txt"
+// frames kept for the per frame lines of the dump, the totals cover them all
+#define GL_TRACE_HISTORY 3600
+
+// Counts the GL calls made through glad per frame by swapping its function
+// pointers for counting wrappers, along with the bytes uploaded from and
+// read back into client memory and the calls that make the CPU wait for the
+// GPU. Only built with -DGL_TRACE=ON, otherwise the calls below are empty
+// and nothing is wrapped. The ImGui renderer loads GL on its own and is not
+// counted.
+#ifdef GL_TRACE
+
+struct GlTraceFrame {
+    uint32_t calls;
+    // glGet* and glReadPixels into client memory
+    uint32_t sync_calls;
+    uint64_t uploaded_bytes;
+    uint64_t read_back_bytes;
+    // the single largest upload and the entry point making it
+    uint64_t largest_upload;
+    const char* largest_upload_call;
+    // per entry point, see glTraceCallName (empty for frames in the history)
+    std::vector<uint32_t> counts;
+};
+
+// after gladLoadGL, the calls made before the first glTraceEndFrame count
+// towards the first frame
+void glTraceInit();
+void glTraceEndFrame();
+const GlTraceFrame& glTraceLastFrame();
+const char* glTraceCallName(size_t call);
+bool glTraceCallSyncs(size_t call);
+// the totals per entry point, then one line per frame of the last
+// GL_TRACE_HISTORY
+void glTraceDump(const std::string& filename);
+
+#else
+
+inline void glTraceInit() {}
+inline void glTraceEndFrame() {}
+inline void glTraceDump(const std::string&) {}
+
+#endif
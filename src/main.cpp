@@ -1,6 +1,10 @@
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <cstring>
 #include <fstream>
+#include <iterator>
+#include <numeric>
 #include <optional>
 #include <print>
 #include <random>
@@ -9,6 +13,12 @@
 
 #include "window.h"
 #include "resources.h"
+#include "render_graph.h"
+#include "dynamic_resolution.h"
+#include "gl_state.h"
+#include "gl_trace.h"
+#include "overdraw.h"
+#include "post_process.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
@@ -21,6 +31,36 @@ struct Window {
     double wheel_yoffset;
 };
 
+struct Passes {
+    RenderGraph graph;
+    PostChain post;
+    RenderGraphHandle background;
+    // the droplet pass draws onto the window, there is no output texture
+    bool direct;
+    int32_t width;
+    int32_t height;
+};
+
+// The GPU time of the frames of a benchmark, from a ring of timer queries
+// that are each read a few frames after they were issued, once their result
+// is available, so timing a frame does not stall the CPU until the GPU is done
+#define BENCHMARK_QUERIES 3
+struct BenchmarkTimer {
+    GLuint queries[BENCHMARK_QUERIES];
+    bool pending[BENCHMARK_QUERIES];
+    // whether the frame the query times counts, i.e. is past the warmup
+    bool counted[BENCHMARK_QUERIES];
+    uint32_t index;
+    double gpu_ms;
+};
+
+// every notch of the mouse wheel zooms by this much
+const float ZOOM_STEP = 1.15f;
+const float MIN_ZOOM = 0.5f;
+const float MAX_ZOOM = 64.0f;
+// how fast the zoom eases towards the one asked for, per second
+const float ZOOM_SMOOTHING = 12.0f;
+
 void captureScreen(int width, int height, const std::string& filename = "screenshot.png") {
     const int channels = 4;
     std::vector<unsigned char> pixels(width * height * channels);
@@ -49,24 +89,65 @@ void processInput(
     double* p_old_posy,
     double mouse_posx,
     double mouse_posy,
-    glm::vec2* p_old_cam_pos
+    glm::vec2* p_old_cam_pos,
+    glm::vec2* p_cam_pos
+);
+void processZoom(
+    double* p_wheel,
+    float dt_s,
+    int scr_width,
+    int scr_height,
+    double mouse_posx,
+    double mouse_posy,
+    float* p_target_zoom,
+    float* p_zoom,
+    glm::vec2* p_old_cam_pos,
+    glm::vec2* p_cam_pos
 );
 Config parseArgs(int argc, char** argv);
-void update(Resources* resources, const float dt_s, std::uniform_real_distribution<>& dis, std::mt19937& gen, const Config config);
-void draw(const Resources& resources, const int scr_width, const int scr_height, const uint32_t rain_count);
+void update(Resources* resources, const float dt_s, std::uniform_real_distribution<>& dis, std::mt19937& gen, const Config& config);
+std::optional<Passes> passesInit(const Resources& resources, const Config& config, int32_t width, int32_t height);
+void renderSize(const Resources& resources, int scr_width, int scr_height, float scale, float zoom, glm::vec2 cam_pos, int32_t* p_width, int32_t* p_height, glm::vec4* p_view);
+void viewAxis(float lo, float hi, int32_t full, int32_t* p_pixels, float* p_corner, float* p_size);
+void passesDeinit(Passes* p_passes);
+void bindPostInputs(const Renderer& renderer, const RenderGraph& graph, const std::vector<RenderGraphHandle>& inputs);
+FrameUniforms frameUniforms(const Resources& resources, const Config& config, const RenderGraphFrame& frame, int32_t width, int32_t height, bool droplet_to_window, glm::vec2 cam_pos, float zoom, glm::vec4 view);
+void drawRain(const Resources& resources, uint32_t rain_count);
+void drawOverdraw(Resources* p_resources, Overdraw* p_overdraw, const RenderGraph& graph, const RenderGraphFrame& frame, const std::string& shown);
+BenchmarkTimer benchmarkTimerInit();
+void benchmarkTimerBegin(BenchmarkTimer* p_timer);
+void benchmarkTimerEnd(BenchmarkTimer* p_timer, bool counted);
+void benchmarkTimerCollect(BenchmarkTimer* p_timer, bool wait);
+void benchmarkTimerRead(BenchmarkTimer* p_timer, uint32_t query);
+void benchmarkTimerDeinit(BenchmarkTimer* p_timer);
+void benchmarkFormats(GLFWwindow* window, Resources* resources, Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen);
+void benchmarkRainAntialiasing(GLFWwindow* window, Resources* resources, Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen);
+bool parseFormats(char* arg, TargetFormats* p_formats);
+bool parsePostEffects(char* arg, std::vector<size_t>* p_effects);
+#ifdef GL_TRACE
+void drawTraceWindow(const GlTraceFrame& trace);
+#endif
 
 void scrollCallback(GLFWwindow* window, double xoffset, double yoffset) {
     Window *win_user = (Window*)glfwGetWindowUserPointer(window);
-    win_user->wheel_xoffset = xoffset;
-    win_user->wheel_yoffset = yoffset;
+    win_user->wheel_xoffset += xoffset;
+    win_user->wheel_yoffset += yoffset;
 }
 
 int main(int argc, char** argv) {
     Config config = parseArgs(argc, argv);
     std::println("Picture: {}", config.picture);
+    if (!config.playlist.empty()) std::println("Playlist: {} pictures every {}s", config.playlist.size(), config.playlist_interval);
     std::println("Rain count: {}", config.rain_count);
     std::println("Speed: {}", config.speed);
     std::println("Color: {} {} {} {}->{}", config.color[0], config.color[1], config.color[2], config.color[3], config.color[4]);
+    std::println("Droplets: {}", config.droplets);
+    std::println("Droplet divisor: {}", config.droplet_divisor);
+    std::println("Quality: {}", DROPLET_QUALITIES[config.quality].name);
+    std::println("Wet glass: {}", config.wet_glass);
+    std::println("CPU droplets: {}{}", config.physics_droplets, config.sprites_only ? " (only)" : "");
+    std::println("Target FPS: {}", config.target_fps);
+    for (size_t effect : config.post_effects) std::println("Post-processing: {}", POST_EFFECTS[effect].name);
 
     GLFWwindow* window = windowInit();
     if (window == NULL) return -1;
@@ -79,14 +160,46 @@ int main(int argc, char** argv) {
     if (!resource_init_result) return -1;
 
     Resources& resources = (*resource_init_result).value();
+    std::println("Renderer: {}", resources.renderer->name);
 
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_BLEND);
+    glStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glStateBlend(true);
 
-    Window win_user = {};
-    glfwSetWindowUserPointer(window, &win_user);
+    if (config.benchmark) {
+        benchmarkFormats(window, &resources, config, dis, gen);
+        benchmarkRainAntialiasing(window, &resources, config, dis, gen);
+        resourcesDeinit(&resources);
+        windowDeinit(&window);
+        return 0;
+    }
+
+    auto dynres_init_result = dynamicResolutionInit(config.target_fps, 0.25, 1.0);
+    if (!dynres_init_result) return -1;
+
+    DynamicResolution& dynres = dynres_init_result.value();
+
+    int scr_width, scr_height;
+    glfwGetFramebufferSize(window, &scr_width, &scr_height);
 
     glm::vec2 old_cam_pos = {0.0, 0.0};
+    glm::vec2 cam_pos = {0.0, 0.0};
+    float zoom = 1.0;
+    float target_zoom = 1.0;
+
+    int32_t render_width, render_height;
+    glm::vec4 view;
+    renderSize(resources, scr_width, scr_height, dynres.scale, zoom, cam_pos, &render_width, &render_height, &view);
+
+    auto passes_init_result = passesInit(resources, config, render_width, render_height);
+    if (!passes_init_result) return -1;
+    dropletTilesResize(&resources.droplet_tiles, render_width, render_height);
+
+    Passes& passes = passes_init_result.value();
+
+    // set before ImGui installs its callbacks, which then pass the wheel on
+    Window win_user = {};
+    glfwSetWindowUserPointer(window, &win_user);
+    glfwSetScrollCallback(window, scrollCallback);
 
     double xpos = 0;
     double ypos = 0;
@@ -108,6 +221,15 @@ int main(int argc, char** argv) {
 
     bool requestCapture = false; // capture flag
 
+    // overdraw debug view, only allocated while shown
+    bool showOverdraw = false;
+    // "all" or the name of a pass that drew something
+    std::string overdrawPass = "all";
+    std::optional<Overdraw> overdraw = std::nullopt;
+
+    // of the last frame, not counting the UI
+    GlStateStats gl_stats = {};
+
     // Main loop
     std::chrono::time_point<std::chrono::steady_clock> start_time = std::chrono::steady_clock::now();
     auto end_time = start_time;
@@ -128,14 +250,103 @@ int main(int argc, char** argv) {
         if (ImGui::Button("Capture Screen")) {
             requestCapture = true; // set capture flag
         }
+        ImGui::Text("Render: %dx%d (%.0f%%)", passes.width, passes.height, dynres.scale * 100.0f);
+        ImGui::Text("GPU: %.2fms", dynres.gpu_ms);
+        ImGui::Text("GL state changes: %u (%u redundant dropped)", gl_stats.changes, gl_stats.redundant);
+        if (resources.droplet_physics) {
+            ImGui::Text("CPU droplets: %zu (%.2fms)", resources.droplet_physics->droplets.size(), resources.droplet_physics->cpu_ms);
+        }
+        int quality = int(config.quality);
+        const char* qualities[std::size(DROPLET_QUALITIES)];
+        for (size_t i = 0; i < std::size(DROPLET_QUALITIES); i++) qualities[i] = DROPLET_QUALITIES[i].name;
+        bool quality_changed = ImGui::Combo("Quality", &quality, qualities, IM_ARRAYSIZE(qualities));
+        ImGui::End();
+
+#ifdef GL_TRACE
+        drawTraceWindow(glTraceLastFrame());
+#endif
+
+        // effects are switched on at the end of the chain
+        bool post_changed = false;
+        ImGui::Begin("Post-processing");
+        for (size_t i = 0; i < POST_EFFECT_COUNT; i++) {
+            auto position = std::find(config.post_effects.begin(), config.post_effects.end(), i);
+            bool enabled = position != config.post_effects.end();
+            if (!ImGui::Checkbox(POST_EFFECTS[i].name, &enabled)) continue;
+            if (enabled) {
+                config.post_effects.push_back(i);
+            } else {
+                config.post_effects.erase(position);
+            }
+            post_changed = true;
+        }
+        ImGui::Text("Stages: %zu", passes.post.stages.size());
+        ImGui::End();
+
+        // the passes depend on the quality (e.g. the blur pyramids) and the
+        // post-processing stages, so they are rebuilt
+        // a quality whose programs fail to compile is not switched to
+        if (quality_changed && size_t(quality) != config.quality) {
+            if (resourcesUseDropletQuality(&resources, DROPLET_QUALITIES[quality], config.wet_glass)) {
+                config.quality = size_t(quality);
+                post_changed = true;
+            } else {
+                std::println("ERR: Failed to switch to quality \"{}\", keeping \"{}\"", DROPLET_QUALITIES[quality].name, DROPLET_QUALITIES[config.quality].name);
+            }
+        }
+        if (post_changed) {
+            auto rebuilt = passesInit(resources, config, passes.width, passes.height);
+            if (!rebuilt) break;
+            passesDeinit(&passes);
+            passes = rebuilt.value();
+        }
+
+        ImGui::Begin("Overdraw");
+        ImGui::Checkbox("Show heatmap", &showOverdraw);
+        if (ImGui::BeginCombo("Pass", overdrawPass.c_str())) {
+            if (ImGui::Selectable("all", overdrawPass == "all")) overdrawPass = "all";
+            if (overdraw) {
+                for (const OverdrawStats& stats : overdraw->stats) {
+                    if (ImGui::Selectable(stats.pass.c_str(), overdrawPass == stats.pass)) overdrawPass = stats.pass;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (overdraw) {
+            for (const OverdrawStats& stats : overdraw->stats) {
+                ImGui::Text("%-10s avg %5.2f  max %4.0f", stats.pass.c_str(), stats.average, stats.max);
+            }
+        }
         ImGui::End();
 
         glfwGetCursorPos(window, &xpos, &ypos);
         bool hold = GLFW_PRESS == glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
 
-        int scr_width, scr_height;
         glfwGetFramebufferSize(window, &scr_width, &scr_height);
 
+        // the wheel over the UI scrolls the UI
+        if (ImGui::GetIO().WantCaptureMouse) win_user.wheel_yoffset = 0.0;
+        processInput(&resources, scr_width, scr_height, &held, hold, &old_xpos, &old_ypos, xpos, ypos, &old_cam_pos, &cam_pos);
+        processZoom(&win_user.wheel_yoffset, dt_s, scr_width, scr_height, xpos, ypos, &target_zoom, &zoom, &old_cam_pos, &cam_pos);
+
+        // a captured frame is rendered at the full scale whatever the dynamic
+        // resolution, the targets go back to it on the next frame
+        const bool capturing = requestCapture;
+        const float render_scale = capturing ? 1.0f : dynres.scale;
+        glm::vec4 frame_view;
+        renderSize(resources, scr_width, scr_height, render_scale, zoom, cam_pos, &render_width, &render_height, &frame_view);
+        if (render_width != passes.width || render_height != passes.height) {
+            if (!renderGraphResize(&passes.graph, render_width, render_height)) break;
+            dropletTilesResize(&resources.droplet_tiles, render_width, render_height);
+            passes.width = render_width;
+            passes.height = render_height;
+        }
+        // the cached background only holds the part of the image that was in view
+        if (frame_view != view) {
+            renderGraphInvalidate(&passes.graph, passes.background);
+            view = frame_view;
+        }
+
         if (glfwGetKey(window, GLFW_KEY_EQUAL) && config.rain_count < RAIN_PARTICLES_COUNT) {
             config.rain_count += 1;
         }
@@ -143,21 +354,73 @@ int main(int argc, char** argv) {
             config.rain_count -= 1;
         }
 
-        processInput(&resources, scr_width, scr_height, &held, hold, &old_xpos, &old_ypos, xpos, ypos, &old_cam_pos);
         update(&resources, dt_s, dis, gen, config);
-        draw(resources, scr_width, scr_height, config.rain_count);
+        // newly streamed in tiles need the cached background drawn again
+        if (resources.virtual_texture
+            && virtualTextureUpdate(&resources.virtual_texture.value(), passes.width, passes.height, view)
+        ) {
+            renderGraphInvalidate(&passes.graph, passes.background);
+        }
+        // so is the next image of the playlist fading in
+        if (resources.playlist && playlistUpdate(&resources.playlist.value(), glfwGetTime())) {
+            renderGraphInvalidate(&passes.graph, passes.background);
+        }
+        if (resources.wet_glass && config.droplets) {
+            wetGlassUpdate(*resources.renderer, &resources.wet_glass.value(), resources.shaders.droplet.wet_glass, glfwGetTime());
+        }
+        if (resources.droplet_physics && config.droplets) {
+            dropletPhysicsUpdate(&resources.droplet_physics.value(), dt_s);
+            dropletSpritesUpload(&resources.droplet_sprites.value(), resources.droplet_physics->sprites);
+        }
+
+        const RenderGraphFrame frame = {
+            .scr_width = scr_width,
+            .scr_height = scr_height,
+            .rain_count = config.rain_count,
+            .time = float(glfwGetTime()),
+            .view = view,
+        };
+
+        frameUniformsUpload(resources.buffers, frameUniforms(resources, config, frame, passes.width, passes.height, passes.direct, cam_pos, zoom, view));
+        if (config.sprites_only) dropletTilesFillDry(&resources.droplet_tiles, passes.width, passes.height);
+        // its GPU time says nothing about the dynamic scale, so it is not timed
+        if (!capturing) dynamicResolutionBegin(&dynres);
+        renderGraphExecute(&passes.graph, frame);
+        if (!capturing) dynamicResolutionEnd(&dynres);
 
-        // Perform screen capture BEFORE rendering UI
+        // Perform screen capture BEFORE rendering UI, and before the overdraw
+        // heatmap takes the place of the image. The passes always end on the
+        // window, with the last post-processing stage or the droplets drawn
+        // directly, so it holds everything that is shown, which no offscreen
+        // target does (e.g. without the droplets the rain is only put over the
+        // background there, the effects are only applied on the way).
         if (requestCapture) {
-            glBindFramebuffer(GL_FRAMEBUFFER, resources.droplet_render_target.framebuffer);
-            captureScreen(resources.droplet_render_target.width, resources.droplet_render_target.height);
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glStateBindFramebuffer(GL_FRAMEBUFFER, 0);
+            captureScreen(scr_width, scr_height);
 
             showCaptureSuccess = true;
             captureSuccessTimer = 0.0f;
             requestCapture = false;
         }
 
+        // the counter covers the passes drawing onto the window as well as
+        // the offscreen ones
+        const int32_t overdraw_width = std::max(passes.width, scr_width);
+        const int32_t overdraw_height = std::max(passes.height, scr_height);
+        if (showOverdraw && !overdraw) {
+            overdraw = overdrawInit(overdraw_width, overdraw_height);
+            if (!overdraw) showOverdraw = false;
+        } else if (!showOverdraw && overdraw) {
+            overdrawDeinit(&overdraw.value());
+            overdraw = std::nullopt;
+        }
+        if (overdraw) {
+            if (overdraw->width != overdraw_width || overdraw->height != overdraw_height) {
+                if (!overdrawResize(&overdraw.value(), overdraw_width, overdraw_height)) break;
+            }
+            drawOverdraw(&resources, &overdraw.value(), passes.graph, frame, overdrawPass);
+        }
+
         // Render UI now
         if (showCaptureSuccess) {
             ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
@@ -178,20 +441,31 @@ int main(int argc, char** argv) {
             }
         }
 
+        gl_stats = glStateEndFrame();
+
         ImGui::EndFrame();
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        glStateInvalidate();
 
         glfwSwapBuffers(window);
 
+        dynamicResolutionUpdate(&dynres);
+        glTraceEndFrame();
+
         end_time = std::chrono::steady_clock::now();
     }
 
+    glTraceDump(GL_TRACE_FILE);
+
     // Cleanup
+    if (overdraw) overdrawDeinit(&overdraw.value());
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    passesDeinit(&passes);
+    dynamicResolutionDeinit(&dynres);
     resourcesDeinit(&resources);
     windowDeinit(&window);
 }
@@ -206,7 +480,8 @@ void processInput(
     double* p_old_posy,
     double mouse_posx,
     double mouse_posy,
-    glm::vec2* p_old_cam_pos
+    glm::vec2* p_old_cam_pos,
+    glm::vec2* p_cam_pos
 ) {
     glm::vec2 delta = {mouse_posx - *p_old_posx, mouse_posy - *p_old_posy};
     delta = delta * glm::vec2(2.0, 2.0)/glm::vec2(scr_width, scr_height);
@@ -219,8 +494,7 @@ void processInput(
     } else {
         if (held) {
             if (hold) {
-                glUseProgram(resources->shaders.screen);
-                glUniform2f(1, cam_pos.x, -cam_pos.y);
+                *p_cam_pos = {cam_pos.x, -cam_pos.y};
             } else {
                 *p_old_cam_pos = cam_pos;
             }
@@ -230,7 +504,38 @@ void processInput(
     *p_held = hold;
 }
 
-void update(Resources* resources, const float dt_s, std::uniform_real_distribution<>& dis, std::mt19937& gen, const Config config) {
+// Eases the zoom towards the one the mouse wheel asks for, moving the camera
+// so the point of the image under the cursor stays there.
+void processZoom(
+    double* p_wheel,
+    float dt_s,
+    int scr_width,
+    int scr_height,
+    double mouse_posx,
+    double mouse_posy,
+    float* p_target_zoom,
+    float* p_zoom,
+    glm::vec2* p_old_cam_pos,
+    glm::vec2* p_cam_pos
+) {
+    *p_target_zoom = std::clamp(*p_target_zoom * std::pow(ZOOM_STEP, float(*p_wheel)), MIN_ZOOM, MAX_ZOOM);
+    *p_wheel = 0.0;
+
+    float zoom = *p_zoom + (*p_target_zoom - *p_zoom) * (1.0f - std::exp(-ZOOM_SMOOTHING * dt_s));
+    // so the view, and with it the cached background, settles
+    if (std::abs(*p_target_zoom - zoom) < 0.001f * *p_target_zoom) zoom = *p_target_zoom;
+    if (zoom == *p_zoom) return;
+
+    const glm::vec2 cursor = {2.0 * mouse_posx / scr_width - 1.0, 1.0 - 2.0 * mouse_posy / scr_height};
+    const glm::vec2 cam_pos = cursor - (cursor - *p_cam_pos) * (zoom / *p_zoom);
+    // a drag in progress carries on from the moved camera, with y flipped
+    // like processInput keeps it
+    *p_old_cam_pos += glm::vec2(cam_pos.x - p_cam_pos->x, p_cam_pos->y - cam_pos.y);
+    *p_cam_pos = cam_pos;
+    *p_zoom = zoom;
+}
+
+void update(Resources* resources, const float dt_s, std::uniform_real_distribution<>& dis, std::mt19937& gen, const Config& config) {
     const float speed = config.speed;
     const uint32_t rain_count = config.rain_count;
     for (size_t i = 0; i < 4*rain_count; i += 4) {
@@ -255,79 +560,686 @@ void update(Resources* resources, const float dt_s, std::uniform_real_distributi
         resources->rain_vertices[i+2] = quad.v[2];
         resources->rain_vertices[i+3] = quad.v[3];
     }
-    glBindBuffer(GL_ARRAY_BUFFER, resources->buffers.rain_vert_buf);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, 4*rain_count*sizeof(RainVertex), resources->rain_vertices);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    rainVerticesUpload(resources->buffers, resources->rain_vertices, 4*rain_count);
 }
 
-void draw(const Resources& resources, const int scr_width, const int scr_height, const uint32_t rain_count) {
-    const Shaders shaders = resources.shaders;
-    const Buffers buffers = resources.buffers;
-    const GLuint image_texture = resources.texture;
-    const RenderTarget render_target = resources.render_target;
-    const RenderTarget droplet_render_target = resources.droplet_render_target;
-
-    // to render target
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, render_target.framebuffer);
-        glViewport(0, 0, render_target.width, render_target.height);
-
-        glClearColor(0.0, 0.0, 0.0, 0.0);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // render image
-        glUseProgram(shaders.texture);
-        glBindVertexArray(buffers.vert_arr);
-        glBindTexture(GL_TEXTURE_2D, image_texture);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(0 * sizeof(GLuint)));
-
-        // render rain
-        glUseProgram(resources.shaders.rain);
-        glBindVertexArray(resources.buffers.rain_vert_arr);
-        glDrawElements(GL_TRIANGLES, 6*rain_count, GL_UNSIGNED_INT, 0);
+std::optional<Passes> passesInit(const Resources& resources, const Config& config, int32_t width, int32_t height) {
+    RenderGraph graph = {};
+
+    // the image never changes, so it is composited once into a cached layer and
+    // only the rain on top of it is rendered every frame
+    const TargetFormats formats = config.formats;
+    const RenderGraphHandle background = renderGraphCreatePersistentTexture(&graph, "background", width, height, formats.background);
+    const RenderGraphHandle rain = renderGraphCreateTexture(&graph, "rain", width, height, formats.rain);
+    const RenderGraphHandle droplet = renderGraphCreateTexture(&graph, "droplet", width, height, formats.droplet);
+    const RenderGraphHandle field = renderGraphCreateScaledTexture(&graph, "droplet field", width, height, config.droplet_divisor, GL_RGBA16F);
+    // the background pyramid is cached along with the background
+    const RenderGraphHandle background_blur = renderGraphCreatePyramid(&graph, "background blur", width, height, formats.background, true);
+    const RenderGraphHandle rain_blur = renderGraphCreatePyramid(&graph, "rain blur", width, height, formats.rain, false);
+    const RenderGraphHandle window = renderGraphImportTarget(&graph, "window", RenderTarget{});
+
+    renderGraphAddPass(&graph, "background", {}, {background}, [&resources, background](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        const Renderer& renderer = *resources.renderer;
+        const Shaders shaders = resources.shaders;
+        const Buffers buffers = resources.buffers;
+        const RenderTarget render_target = renderGraphTarget(graph, background);
+
+        renderer.begin_pass(RendererPass{
+            .framebuffer = render_target.framebuffer,
+            .width = render_target.width,
+            .height = render_target.height,
+            .clear = glm::vec4(0.0),
+        });
+        if (resources.playlist) {
+            renderer.set_pipeline({ .program = shaders.playlist, .blend = RENDERER_BLEND_ALPHA });
+            playlistBind(resources.playlist.value(), shaders.playlist);
+        } else if (resources.virtual_texture) {
+            renderer.set_pipeline({ .program = shaders.virtual_texture, .blend = RENDERER_BLEND_ALPHA });
+            virtualTextureBind(resources.virtual_texture.value(), shaders.virtual_texture);
+        } else {
+            renderer.set_pipeline({ .program = shaders.texture, .blend = RENDERER_BLEND_ALPHA });
+            renderer.bind_texture(0, resources.texture, RENDERER_TEXTURE_2D);
+        }
+        renderer.draw_indexed(buffers.vert_arr, 0, 6);
+        renderer.end_pass();
+    });
+
+    // rain is kept premultiplied so it can be put over the background later
+    renderGraphAddPass(&graph, "rain", {}, {rain}, [&resources, rain](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        const Renderer& renderer = *resources.renderer;
+        const RenderTarget render_target = renderGraphTarget(graph, rain);
+
+        renderer.begin_pass(RendererPass{
+            .framebuffer = render_target.framebuffer,
+            .width = render_target.width,
+            .height = render_target.height,
+            .clear = glm::vec4(0.0),
+        });
+        drawRain(resources, frame.rain_count);
+        renderer.end_pass();
+    });
+
+    // the droplets change slowly across the screen, so unless the divisor is 1
+    // a compute shader evaluates them once per frame into a small field of
+    // distortion offsets and strengths which the droplet pass upsamples,
+    // instead of for every pixel. The wet glass simulation always goes through
+    // the field, which it is turned into at any divisor.
+    const bool split_droplets = !config.sprites_only && (config.droplet_divisor > 1 || config.wet_glass);
+    if (split_droplets) {
+        // the scene is read for the luma guiding the upsampling
+        renderGraphAddPass(&graph, "droplet field", {background, rain}, {field}, [&resources, background, rain, field](const RenderGraph& graph, const RenderGraphFrame& frame) {
+            const Renderer& renderer = *resources.renderer;
+            const Shaders shaders = resources.shaders;
+            const RenderTarget render_target = renderGraphTarget(graph, field);
+
+            if (resources.wet_glass) wetGlassBind(resources.wet_glass.value());
+            renderer.bind_texture(1, renderGraphTarget(graph, rain).texture, RENDERER_TEXTURE_2D);
+            renderer.bind_texture(0, renderGraphTarget(graph, background).texture, RENDERER_TEXTURE_2D);
+            renderer.bind_storage_image(0, render_target.texture, RENDERER_FORMAT_RGBA16F);
+            renderer.dispatch(shaders.droplet.field, (render_target.width + 7) / 8, (render_target.height + 7) / 8);
+            renderer.barrier(RENDERER_BARRIER_TEXTURE_FETCH);
+        });
     }
 
-    // to another render target
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, droplet_render_target.framebuffer);
-        glViewport(0, 0, droplet_render_target.width, droplet_render_target.height);
+    // the droplets blur what is behind them by sampling the blur pyramids
+    renderGraphAddPass(&graph, "background blur", {background}, {background_blur}, [&resources, background, background_blur](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        blurBuildPyramid(resources.blur, renderGraphTarget(graph, background).texture, renderGraphTarget(graph, background_blur), DROPLET_BLUR_RADIUS / frame.view.w);
+    });
+    renderGraphAddPass(&graph, "rain blur", {rain}, {rain_blur}, [&resources, rain, rain_blur](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        blurBuildPyramid(resources.blur, renderGraphTarget(graph, rain).texture, renderGraphTarget(graph, rain_blur), DROPLET_BLUR_RADIUS / frame.view.w);
+    });
 
-        glClearColor(0.0, 0.0, 0.0, 0.0);
-        glClear(GL_COLOR_BUFFER_BIT);
+    // the droplet shader puts the rain over the background itself and writes
+    // opaque output over every pixel, so there is nothing to clear, copy or blend.
+    // It only runs on the tiles droplets can reach, the rest just get the tint.
+    // without blur nothing reads the pyramids and their passes get culled
+    const bool blur = DROPLET_QUALITIES[config.quality].blur;
+    std::vector<RenderGraphHandle> droplet_inputs = {background, rain};
+    if (blur) {
+        droplet_inputs.push_back(background_blur);
+        droplet_inputs.push_back(rain_blur);
+    }
+    if (split_droplets) droplet_inputs.push_back(field);
 
-        glUseProgram(shaders.texture);
-        glBindVertexArray(buffers.vert_arr);
-        glBindTexture(GL_TEXTURE_2D, render_target.texture);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(0 * sizeof(GLuint)));
+    // Unless something post-processes the droplet image, it would only be
+    // drawn onto the window as it is, so the droplet pass draws its tiles
+    // there itself with the window transform and the droplet texture and the
+    // window pass are left out. The tiles then shade every window pixel the
+    // image covers rather than every render pixel.
+    const bool direct = config.direct && config.droplets && config.post_effects.empty();
+    const RenderGraphHandle droplet_output = direct ? window : droplet;
+    // With only the sprites drawing droplets, every tile is dry and the cost
+    // follows how much of the glass the droplets cover.
+    const bool sprites_only = config.sprites_only;
+    renderGraphAddPass(&graph, "droplet", droplet_inputs, {droplet_output}, [&resources, background, rain, background_blur, rain_blur, field, droplet, split_droplets, blur, direct, sprites_only](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        const Renderer& renderer = *resources.renderer;
+        const Shaders shaders = resources.shaders;
+        const RenderTarget background_render_target = renderGraphTarget(graph, background);
+        const int32_t width = background_render_target.width;
+        const int32_t height = background_render_target.height;
+        const GLuint program = split_droplets ? shaders.droplet.composite : shaders.droplet.shade;
 
-        // render droplets
-        glUseProgram(resources.shaders.droplet);
-        glUniform1f(glGetUniformLocation(resources.shaders.droplet, "u_time"), glfwGetTime());
-        glUniform1i(glGetUniformLocation(resources.shaders.droplet, "u_texture"), 0);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(0 * sizeof(GLuint)));
+        // with only the sprites, the lists were filled before the graph ran
+        if (!sprites_only) {
+            if (resources.wet_glass) wetGlassBind(resources.wet_glass.value());
+            dropletTilesClassify(renderer, resources.droplet_tiles, shaders.droplet.classify, width, height);
+        }
+
+        if (direct) {
+            renderer.begin_pass(RendererPass{
+                .framebuffer = 0,
+                .width = frame.scr_width,
+                .height = frame.scr_height,
+                .clear = glm::vec4(0.1, 0.1, 0.1, 1.0),
+            });
+        } else {
+            renderer.begin_pass(RendererPass{
+                .framebuffer = renderGraphTarget(graph, droplet).framebuffer,
+                .width = width,
+                .height = height,
+                .clear = std::nullopt,
+            });
+        }
+
+        renderer.set_pipeline({ .program = program, .blend = RENDERER_BLEND_OPAQUE });
+        if (blur) {
+            renderer.bind_texture(4, renderGraphTarget(graph, rain_blur).texture, RENDERER_TEXTURE_2D);
+            renderer.bind_texture(3, renderGraphTarget(graph, background_blur).texture, RENDERER_TEXTURE_2D);
+        }
+        if (split_droplets) {
+            renderer.bind_texture(2, renderGraphTarget(graph, field).texture, RENDERER_TEXTURE_2D);
+        }
+        renderer.bind_texture(1, renderGraphTarget(graph, rain).texture, RENDERER_TEXTURE_2D);
+        renderer.bind_texture(0, renderGraphTarget(graph, background).texture, RENDERER_TEXTURE_2D);
+        if (!sprites_only) dropletTilesDraw(renderer, resources.droplet_tiles, true);
+
+        renderer.set_pipeline({ .program = shaders.droplet.dry, .blend = RENDERER_BLEND_OPAQUE });
+        dropletTilesDraw(renderer, resources.droplet_tiles, false);
+
+        // the droplets of the CPU simulation go over the rest, keeping the
+        // opaque alpha of the target
+        if (resources.droplet_sprites) {
+            renderer.set_pipeline({ .program = shaders.droplet.sprite, .blend = RENDERER_BLEND_KEEP_ALPHA });
+            dropletSpritesDraw(renderer, resources.droplet_sprites.value());
+        }
+        renderer.end_pass();
+    });
+
+    // without droplets nothing reads the droplet texture and its pass gets culled,
+    // the post-processing chain then puts the rain over the background itself
+    const std::vector<RenderGraphHandle> outputs = config.droplets
+        ? std::vector<RenderGraphHandle>{droplet}
+        : std::vector<RenderGraphHandle>{background, rain};
+
+    if (direct) {
+        if (!renderGraphCompile(&graph)) {
+            renderGraphDeinit(&graph);
+            return std::nullopt;
+        }
+        return Passes{
+            .graph = graph,
+            .post = {},
+            .background = background,
+            .direct = true,
+            .width = width,
+            .height = height,
+        };
     }
 
-    // to window
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, scr_width, scr_height);
+    auto post_init_result = postChainInit(config.post_effects, !config.droplets);
+    if (!post_init_result) {
+        renderGraphDeinit(&graph);
+        return std::nullopt;
+    }
+    PostChain post = post_init_result.value();
 
-        glClearColor(0.1, 0.1, 0.1, 1.0);
-        glClear(GL_COLOR_BUFFER_BIT);
+    // every stage but the last renders a target at the render size for the
+    // neighborhood effect starting the next one
+    std::vector<RenderGraphHandle> post_inputs = outputs;
+    for (size_t i = 0; i + 1 < post.stages.size(); i++) {
+        const std::string name = "post " + std::to_string(i);
+        const RenderGraphHandle stage_output = renderGraphCreateTexture(&graph, name, width, height, formats.droplet);
+        const GLuint program = post.stages[i];
+        const GLuint empty_vert_arr = post.empty_vert_arr;
+        renderGraphAddPass(&graph, name, post_inputs, {stage_output}, [&resources, post_inputs, stage_output, program, empty_vert_arr](const RenderGraph& graph, const RenderGraphFrame& frame) {
+            const Renderer& renderer = *resources.renderer;
+            const RenderTarget render_target = renderGraphTarget(graph, stage_output);
 
-        glUseProgram(shaders.screen);
-        glUniform2f(0, float(scr_height)/(scr_width), 1.0);
-        glBindVertexArray(buffers.vert_arr);
-        glBindTexture(GL_TEXTURE_2D, droplet_render_target.texture);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(6 * sizeof(GLuint)));
+            renderer.begin_pass(RendererPass{
+                .framebuffer = render_target.framebuffer,
+                .width = render_target.width,
+                .height = render_target.height,
+                .clear = std::nullopt,
+            });
+            renderer.set_pipeline({ .program = program, .blend = RENDERER_BLEND_OPAQUE });
+            bindPostInputs(renderer, graph, post_inputs);
+            renderer.draw(empty_vert_arr, 0, 3, 1);
+            renderer.end_pass();
+        });
+        post_inputs = {stage_output};
     }
+
+    // the last stage draws the image with premultiplied output
+    const GLuint window_program = post.stages.back();
+    renderGraphAddPass(&graph, "window", post_inputs, {window}, [&resources, post_inputs, window_program](const RenderGraph& graph, const RenderGraphFrame& frame) {
+        const Renderer& renderer = *resources.renderer;
+        const Buffers buffers = resources.buffers;
+
+        renderer.begin_pass(RendererPass{
+            .framebuffer = 0,
+            .width = frame.scr_width,
+            .height = frame.scr_height,
+            .clear = glm::vec4(0.1, 0.1, 0.1, 1.0),
+        });
+        renderer.set_pipeline({ .program = window_program, .blend = RENDERER_BLEND_PREMULTIPLIED });
+        bindPostInputs(renderer, graph, post_inputs);
+        renderer.draw_indexed(buffers.vert_arr, 6, 6);
+        renderer.end_pass();
+    });
+
+    if (!renderGraphCompile(&graph)) {
+        postChainDeinit(&post);
+        renderGraphDeinit(&graph);
+        return std::nullopt;
+    }
+
+    return Passes{
+        .graph = graph,
+        .post = post,
+        .background = background,
+        .direct = false,
+        .width = width,
+        .height = height,
+    };
+}
+
+void passesDeinit(Passes* p_passes) {
+    renderGraphDeinit(&p_passes->graph);
+    postChainDeinit(&p_passes->post);
+}
+
+// the image on unit 0 and the layer over it, if any, on unit 1
+void bindPostInputs(const Renderer& renderer, const RenderGraph& graph, const std::vector<RenderGraphHandle>& inputs) {
+    if (inputs.size() > 1) {
+        renderer.bind_texture(1, renderGraphTarget(graph, inputs[1]).texture, RENDERER_TEXTURE_2D);
+    }
+    renderer.bind_texture(0, renderGraphTarget(graph, inputs[0]).texture, RENDERER_TEXTURE_2D);
+}
+
+FrameUniforms frameUniforms(const Resources& resources, const Config& config, const RenderGraphFrame& frame, int32_t width, int32_t height, bool droplet_to_window, glm::vec2 cam_pos, float zoom, glm::vec4 view) {
+    // upsampled droplets reach up to a field texel past where they are evaluated
+    const float droplet_margin = config.droplet_divisor > 1 ? float(config.droplet_divisor) : 0.0f;
+    return FrameUniforms{
+        .scale = {zoom*frame.scr_height/frame.scr_width, zoom},
+        .cam_pos = cam_pos,
+        .resolution = {width, height},
+        .time = frame.time,
+        .droplet_margin = droplet_margin,
+        .tint = {0.6, 0.7, 0.8, 0.1},
+        .tile_count = resources.droplet_tiles.max_tiles,
+        .droplet_to_window = droplet_to_window,
+        .rain_half_width = 0.5f * float(RAIN_WIDTH) * resources.texture_height / resources.texture_width,
+        .rain_antialiased = config.rain_antialiased,
+        .view = view,
+    };
+}
+
+// premultiplied, over whatever the target of the pass holds
+void drawRain(const Resources& resources, uint32_t rain_count) {
+    const Renderer& renderer = *resources.renderer;
+    renderer.set_pipeline({ .program = resources.shaders.rain, .blend = RENDERER_BLEND_PREMULTIPLY });
+    renderer.draw_indexed(resources.buffers.rain_vert_arr, 0, 6*rain_count);
+}
+
+// The offscreen targets only need as many pixels as the image covers on the
+// window (see the window pass), times scale, and never more than the image has.
+// Of those they only hold the ones of the part of the image on the window, the
+// view (its corner in xy and size in zw, in uv of the image), so zoomed into a
+// large image they cost what the window does.
+void renderSize(const Resources& resources, int scr_width, int scr_height, float scale, float zoom, glm::vec2 cam_pos, int32_t* p_width, int32_t* p_height, glm::vec4* p_view) {
+    const float displayed_height = 0.5f * scr_height * zoom;
+    const float factor = std::min(scale * displayed_height / resources.texture_height, 1.0f);
+    const int32_t full_width = std::max(1, int32_t(std::round(factor * resources.texture_width)));
+    const int32_t full_height = std::max(1, int32_t(std::round(factor * resources.texture_height)));
+
+    // half the size of the image quad in clip space, see the screen shader
+    const glm::vec2 half_size = {
+        0.5f * zoom * scr_height / scr_width * resources.texture_width / resources.texture_height,
+        0.5f * zoom,
+    };
+    const glm::vec2 lo = ((glm::vec2(-1.0f) - cam_pos) / half_size + 1.0f) * 0.5f;
+    const glm::vec2 hi = ((glm::vec2(1.0f) - cam_pos) / half_size + 1.0f) * 0.5f;
+    viewAxis(lo.x, hi.x, full_width, p_width, &p_view->x, &p_view->z);
+    viewAxis(lo.y, hi.y, full_height, p_height, &p_view->y, &p_view->w);
+}
+
+// The pixels along one axis of the window, from lo to hi in uv of the image,
+// out of the full ones of the image. They are whole pixels of the full target,
+// so the image does not shimmer while panning, plus one for the fractions on
+// either end, so panning within the image keeps the count and only zooming
+// resizes the targets.
+void viewAxis(float lo, float hi, int32_t full, int32_t* p_pixels, float* p_corner, float* p_size) {
+    const float visible = std::clamp(hi, 0.0f, 1.0f) - std::clamp(lo, 0.0f, 1.0f);
+    const int32_t pixels = std::clamp(int32_t(std::ceil(visible * full)) + 1, 1, full);
+    if (pixels == full) {
+        *p_pixels = full;
+        *p_corner = 0.0f;
+        *p_size = 1.0f;
+        return;
+    }
+    const float first = std::min(std::floor(std::clamp(lo, 0.0f, 1.0f) * full), float(full - pixels));
+    *p_pixels = pixels;
+    *p_corner = first / full;
+    *p_size = float(pixels) / full;
+}
+
+// Runs every live pass of the graph again, cached or not, with the draws
+// going to the overdraw counter instead of their targets, then shows the
+// heatmap of the chosen ("all" for the sum) pass over the window.
+void drawOverdraw(Resources* p_resources, Overdraw* p_overdraw, const RenderGraph& graph, const RenderGraphFrame& frame, const std::string& shown) {
+    const Renderer* renderer = p_resources->renderer;
+    p_resources->renderer = &RENDERER_OVERDRAW;
+
+    overdrawBegin(p_overdraw, p_resources->buffers.vert_arr, frame.scr_width, frame.scr_height);
+    for (size_t i : graph.order) {
+        const RenderGraphPass& pass = graph.passes[i];
+        overdrawPassBegin(p_overdraw);
+        pass.execute(graph, frame);
+        overdrawPassEnd(p_overdraw, pass.name, shown == "all" || shown == pass.name);
+    }
+    overdrawEnd(p_overdraw);
+
+    p_resources->renderer = renderer;
+}
+
+#ifdef GL_TRACE
+// the totals of the last frame and its busiest entry points
+void drawTraceWindow(const GlTraceFrame& trace) {
+    ImGui::Begin("GL calls");
+    ImGui::Text("Calls: %u (%u waiting for the GPU)", trace.calls, trace.sync_calls);
+    ImGui::Text("Uploaded: %.1f KB", trace.uploaded_bytes / 1024.0);
+    if (trace.largest_upload_call) {
+        ImGui::Text("Largest upload: %.1f KB (%s)", trace.largest_upload / 1024.0, trace.largest_upload_call);
+    }
+    ImGui::Text("Read back: %.1f KB", trace.read_back_bytes / 1024.0);
+
+    std::vector<size_t> order(trace.counts.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return trace.counts[a] > trace.counts[b]; });
+    for (size_t i = 0; i < std::min(order.size(), size_t(12)); i++) {
+        const size_t call = order[i];
+        if (trace.counts[call] == 0) break;
+        ImGui::Text("%6u %s%s", trace.counts[call], glTraceCallName(call), glTraceCallSyncs(call) ? " (sync)" : "");
+    }
+    ImGui::End();
+}
+#endif
+
+BenchmarkTimer benchmarkTimerInit() {
+    BenchmarkTimer timer = {};
+    glGenQueries(BENCHMARK_QUERIES, timer.queries);
+    return timer;
+}
+
+void benchmarkTimerBegin(BenchmarkTimer* p_timer) {
+    benchmarkTimerCollect(p_timer, false);
+    // only a query still running BENCHMARK_QUERIES frames later is waited on
+    if (p_timer->pending[p_timer->index]) benchmarkTimerRead(p_timer, p_timer->index);
+    glBeginQuery(GL_TIME_ELAPSED, p_timer->queries[p_timer->index]);
+}
+
+void benchmarkTimerEnd(BenchmarkTimer* p_timer, bool counted) {
+    glEndQuery(GL_TIME_ELAPSED);
+    p_timer->pending[p_timer->index] = true;
+    p_timer->counted[p_timer->index] = counted;
+    p_timer->index = (p_timer->index + 1) % BENCHMARK_QUERIES;
+}
+
+// adds up the finished queries, or all of them when waiting for the GPU
+void benchmarkTimerCollect(BenchmarkTimer* p_timer, bool wait) {
+    for (uint32_t i = 0; i < BENCHMARK_QUERIES; i++) {
+        if (!p_timer->pending[i]) continue;
+        if (!wait) {
+            GLint available = 0;
+            glGetQueryObjectiv(p_timer->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) continue;
+        }
+        benchmarkTimerRead(p_timer, i);
+    }
+}
+
+void benchmarkTimerRead(BenchmarkTimer* p_timer, uint32_t query) {
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(p_timer->queries[query], GL_QUERY_RESULT, &ns);
+    if (p_timer->counted[query]) p_timer->gpu_ms += ns / 1000000.0;
+    p_timer->pending[query] = false;
+}
+
+void benchmarkTimerDeinit(BenchmarkTimer* p_timer) {
+    glDeleteQueries(BENCHMARK_QUERIES, p_timer->queries);
+    for (uint32_t i = 0; i < BENCHMARK_QUERIES; i++) {
+        p_timer->queries[i] = 0;
+        p_timer->pending[i] = false;
+    }
+}
+
+// Renders a fixed number of frames with every target format at the displayed
+// size and reports the estimated target traffic and the time per frame.
+void benchmarkFormats(GLFWwindow* window, Resources* resources, Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen) {
+    const uint32_t warmup_frames = 60;
+    const uint32_t frames = 300;
+
+    // measure the frames, not the display
+    glfwSwapInterval(0);
+
+    int scr_width, scr_height;
+    glfwGetFramebufferSize(window, &scr_width, &scr_height);
+    int32_t width, height;
+    glm::vec4 view;
+    renderSize(*resources, scr_width, scr_height, 1.0, 1.0, {0.0, 0.0}, &width, &height, &view);
+
+    std::println("Format benchmark at {}x{}, {} frames each", width, height, frames);
+    std::println("{:>12} {:>5} {:>10} {:>8} {:>9}", "format", "B/px", "MB/frame", "GPU ms", "frame ms");
+    for (const RenderTargetFormat& format : RENDER_TARGET_FORMATS) {
+        // the rain layer is blended later so it keeps its alpha
+        config.formats = TargetFormats{
+            .background = format.format,
+            .rain = format.alpha ? format.format : GL_RGBA8,
+            .droplet = format.format,
+        };
+        auto passes = passesInit(*resources, config, width, height);
+        if (!passes) continue;
+        dropletTilesResize(&resources->droplet_tiles, width, height);
+
+        BenchmarkTimer timer = benchmarkTimerInit();
+        size_t bytes = 0;
+        auto start_time = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < warmup_frames + frames; i++) {
+            if (i == warmup_frames) start_time = std::chrono::steady_clock::now();
+
+            glfwPollEvents();
+            update(resources, 1.0f / 60.0f, dis, gen, config);
+            if (resources->virtual_texture
+                && virtualTextureUpdate(&resources->virtual_texture.value(), width, height, view)
+            ) {
+                renderGraphInvalidate(&passes->graph, passes->background);
+            }
+
+            const RenderGraphFrame frame = {
+                .scr_width = scr_width,
+                .scr_height = scr_height,
+                .rain_count = config.rain_count,
+                .time = float(glfwGetTime()),
+                .view = view,
+            };
+            frameUniformsUpload(resources->buffers, frameUniforms(*resources, config, frame, width, height, passes->direct, {0.0, 0.0}, 1.0, view));
+            if (config.sprites_only) dropletTilesFillDry(&resources->droplet_tiles, width, height);
+
+            benchmarkTimerBegin(&timer);
+            renderGraphExecute(&passes->graph, frame);
+            benchmarkTimerEnd(&timer, i >= warmup_frames);
+            glfwSwapBuffers(window);
+
+            if (i >= warmup_frames) bytes += passes->graph.frame_bytes;
+        }
+        const double frame_ms = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time
+        ).count() / 1000.0 / frames;
+        benchmarkTimerCollect(&timer, true);
+
+        std::println(
+            "{:>12} {:>5} {:>10.1f} {:>8.3f} {:>9.3f}",
+            format.name,
+            format.bytes_per_pixel,
+            bytes / double(frames) / (1024.0 * 1024.0),
+            timer.gpu_ms / frames,
+            frame_ms
+        );
+        benchmarkTimerDeinit(&timer);
+        passesDeinit(&passes.value());
+    }
+
+    glfwSwapInterval(1);
+}
+
+// Renders just the rain for a fixed number of frames at the displayed size,
+// once with the analytic anti-aliasing and once each with 4x and 8x MSAA
+// targets (resolved to a single sample one every frame), and reports the
+// memory of the target and the time per frame.
+void benchmarkRainAntialiasing(GLFWwindow* window, Resources* resources, Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen) {
+    const uint32_t warmup_frames = 60;
+    const uint32_t frames = 300;
+
+    glfwSwapInterval(0);
+
+    int scr_width, scr_height;
+    glfwGetFramebufferSize(window, &scr_width, &scr_height);
+    int32_t width, height;
+    glm::vec4 view;
+    renderSize(*resources, scr_width, scr_height, 1.0, 1.0, {0.0, 0.0}, &width, &height, &view);
+
+    auto resolved_init_result = renderTargetInit(width, height, GL_RGBA8);
+    if (!resolved_init_result) return;
+    RenderTarget resolved = resolved_init_result.value();
+
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+
+    std::println("Rain anti-aliasing benchmark at {}x{}, {} frames each", width, height, frames);
+    std::println("{:>8} {:>7} {:>10} {:>8}", "mode", "samples", "target MB", "GPU ms");
+    for (GLsizei samples : {1, 4, 8}) {
+        if (samples > max_samples) continue;
+        config.rain_antialiased = samples == 1;
+
+        GLuint framebuffer = resolved.framebuffer;
+        GLuint renderbuffer = 0;
+        if (samples > 1) {
+            glGenFramebuffers(1, &framebuffer);
+            glStateBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glGenRenderbuffers(1, &renderbuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::println("ERR: {}x MSAA framebuffer creation failed", samples);
+                glDeleteRenderbuffers(1, &renderbuffer);
+                glStateDeleteFramebuffers(1, &framebuffer);
+                continue;
+            }
+        }
+
+        BenchmarkTimer timer = benchmarkTimerInit();
+        for (uint32_t i = 0; i < warmup_frames + frames; i++) {
+            glfwPollEvents();
+            update(resources, 1.0f / 60.0f, dis, gen, config);
+
+            const RenderGraphFrame frame = {
+                .scr_width = scr_width,
+                .scr_height = scr_height,
+                .rain_count = config.rain_count,
+                .time = float(glfwGetTime()),
+                .view = view,
+            };
+            frameUniformsUpload(resources->buffers, frameUniforms(*resources, config, frame, width, height, false, {0.0, 0.0}, 1.0, view));
+
+            benchmarkTimerBegin(&timer);
+            resources->renderer->begin_pass(RendererPass{
+                .framebuffer = framebuffer,
+                .width = width,
+                .height = height,
+                .clear = glm::vec4(0.0),
+            });
+            drawRain(*resources, config.rain_count);
+            resources->renderer->end_pass();
+            if (samples > 1) {
+                glStateBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolved.framebuffer);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+            benchmarkTimerEnd(&timer, i >= warmup_frames);
+            glStateBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glfwSwapBuffers(window);
+        }
+        benchmarkTimerCollect(&timer, true);
+
+        // the multisampled target comes on top of the resolved one
+        const size_t bytes = size_t(width) * height * 4 * (samples > 1 ? samples + 1 : 1);
+        std::println(
+            "{:>8} {:>7} {:>10.1f} {:>8.3f}",
+            samples == 1 ? "analytic" : "msaa",
+            samples,
+            bytes / (1024.0 * 1024.0),
+            timer.gpu_ms / frames
+        );
+        benchmarkTimerDeinit(&timer);
+
+        if (samples > 1) {
+            glDeleteRenderbuffers(1, &renderbuffer);
+            glStateDeleteFramebuffers(1, &framebuffer);
+        }
+    }
+
+    renderTargetDeinit(&resolved);
+    glfwSwapInterval(1);
+}
+
+// "format" for every target, or "target=format,..." with targets background,
+// rain and droplet. The rain layer needs alpha.
+bool parseFormats(char* arg, TargetFormats* p_formats) {
+    for (char* item = strtok(arg, ","); item != NULL; item = strtok(NULL, ",")) {
+        char* name = item;
+        char* value = strchr(item, '=');
+        if (value != NULL) {
+            *value = '\0';
+            value += 1;
+        } else {
+            name = NULL;
+            value = item;
+        }
+
+        auto format = renderTargetFormat(std::string(value));
+        if (!format) {
+            std::println("Unknown target format \"{}\"!", value);
+            return false;
+        }
+
+        if (name == NULL) {
+            p_formats->background = format->format;
+            p_formats->droplet = format->format;
+            if (format->alpha) p_formats->rain = format->format;
+        } else if (strcmp(name, "background") == 0) {
+            p_formats->background = format->format;
+        } else if (strcmp(name, "droplet") == 0) {
+            p_formats->droplet = format->format;
+        } else if (strcmp(name, "rain") == 0) {
+            if (!format->alpha) {
+                std::println("The rain target needs a format with alpha!");
+                return false;
+            }
+            p_formats->rain = format->format;
+        } else {
+            std::println("Unknown target \"{}\"!", name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// "effect,..." in the order they are applied
+bool parsePostEffects(char* arg, std::vector<size_t>* p_effects) {
+    for (char* item = strtok(arg, ","); item != NULL; item = strtok(NULL, ",")) {
+        auto effect = postEffectIndex(std::string(item));
+        if (!effect) {
+            std::println("Unknown post-processing effect \"{}\"!", item);
+            return false;
+        }
+        if (std::find(p_effects->begin(), p_effects->end(), effect.value()) != p_effects->end()) {
+            std::println("Post-processing effect \"{}\" is listed twice!", item);
+            return false;
+        }
+        p_effects->push_back(effect.value());
+    }
+    return true;
 }
 
 Config parseArgs(int argc, char** argv) {
     uint32_t rain_count = 256;
     float speed = 1.0;
-    std::optional<std::string> picture = std::nullopt;
+    std::vector<std::string> pictures = {};
+    float playlist_interval = 10.0;
     float color[5] = {0.0, 0.0, 1.0, 0.0, 1.0};
+    bool droplets = true;
+    int32_t droplet_divisor = 1;
+    size_t quality = 1;
+    float target_fps = 60.0;
+    bool virtual_texture = false;
+    TargetFormats formats = { .background = GL_RGBA8, .rain = GL_RGBA8, .droplet = GL_RGBA8 };
+    std::vector<size_t> post_effects = {};
+    bool direct = true;
+    bool rain_antialiased = true;
+    bool wet_glass = false;
+    size_t physics_droplets = 0;
+    bool sprites_only = false;
+    bool benchmark = false;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-n") == 0) {
             i += 1;
@@ -356,16 +1268,100 @@ Config parseArgs(int argc, char** argv) {
                 }
             }
             color[num] = atof(s);
+        } else if (strcmp(argv[i], "-f") == 0) {
+            i += 1;
+            target_fps = atof(argv[i]);
+            if (target_fps < 0.0) {
+                std::println("Target FPS cannot be < 0.0!");
+                target_fps = 60.0;
+            }
+        } else if (strcmp(argv[i], "-r") == 0) {
+            i += 1;
+            droplet_divisor = atoi(argv[i]);
+            if (droplet_divisor != 1 && droplet_divisor != 2 && droplet_divisor != 4) {
+                std::println("Droplet divisor must be 1, 2 or 4!");
+                droplet_divisor = 1;
+            }
+        } else if (strcmp(argv[i], "-q") == 0) {
+            i += 1;
+            bool found = false;
+            for (size_t j = 0; j < std::size(DROPLET_QUALITIES); j++) {
+                if (strcmp(argv[i], DROPLET_QUALITIES[j].name) == 0) {
+                    quality = j;
+                    found = true;
+                }
+            }
+            if (!found) std::println("Unknown quality \"{}\"!", argv[i]);
+        } else if (strcmp(argv[i], "-F") == 0) {
+            i += 1;
+            TargetFormats parsed = formats;
+            if (parseFormats(argv[i], &parsed)) formats = parsed;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            i += 1;
+            std::vector<size_t> parsed = {};
+            if (parsePostEffects(argv[i], &parsed)) post_effects = parsed;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            i += 1;
+            playlist_interval = atof(argv[i]);
+            if (playlist_interval < 0.0) {
+                std::println("Playlist interval cannot be < 0.0!");
+                playlist_interval = 10.0;
+            }
+        } else if (strcmp(argv[i], "-a") == 0) {
+            rain_antialiased = false;
+        } else if (strcmp(argv[i], "-w") == 0) {
+            wet_glass = true;
+        } else if (strcmp(argv[i], "-m") == 0) {
+            i += 1;
+            const long count = atol(argv[i]);
+            if (count < 0) {
+                std::println("CPU droplet count cannot be < 0!");
+            } else {
+                physics_droplets = size_t(count);
+            }
+        } else if (strcmp(argv[i], "-S") == 0) {
+            sprites_only = true;
+        } else if (strcmp(argv[i], "-i") == 0) {
+            direct = false;
+        } else if (strcmp(argv[i], "-b") == 0) {
+            benchmark = true;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            virtual_texture = true;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            droplets = false;
         } else {
-            picture = std::string(argv[i]);
+            pictures.push_back(std::string(argv[i]));
         }
     }
-    if (!picture) picture = "assets/default.png";
+    if (pictures.empty()) pictures.push_back("assets/default.png");
+    if (sprites_only && physics_droplets == 0) {
+        std::println("Only CPU droplets needs -m!");
+        sprites_only = false;
+    }
+    if (sprites_only && wet_glass) {
+        std::println("Only CPU droplets leaves no room for the wet glass!");
+        wet_glass = false;
+    }
 
     Config conf = Config{
-        .picture = picture.value(),
+        .picture = pictures[0],
+        .playlist = pictures.size() > 1 ? pictures : std::vector<std::string>{},
+        .playlist_interval = playlist_interval,
         .rain_count = rain_count,
         .speed = speed,
+        .droplets = droplets,
+        .droplet_divisor = droplet_divisor,
+        .quality = quality,
+        .target_fps = target_fps,
+        .virtual_texture = virtual_texture,
+        .formats = formats,
+        .post_effects = post_effects,
+        .direct = direct,
+        .rain_antialiased = rain_antialiased,
+        .wet_glass = wet_glass,
+        .physics_droplets = physics_droplets,
+        .sprites_only = sprites_only,
+        .benchmark = benchmark,
     };
     for (int i = 0; i < 5; i++) conf.color[i] = color[i];
 
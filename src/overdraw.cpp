@@ -0,0 +1,299 @@
+#include "overdraw.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+
+void overdrawRendererBeginPass(const RendererPass& pass);
+void overdrawRendererEndPass();
+
+// the Overdraw between overdrawPassBegin and overdrawPassEnd
+Overdraw* g_counting = NULL;
+
+// only where the passes draw differs from the GL backend
+const Renderer RENDERER_OVERDRAW = {
+    .name = "overdraw",
+    .begin_pass = overdrawRendererBeginPass,
+    .end_pass = overdrawRendererEndPass,
+    .set_pipeline = RENDERER_GL.set_pipeline,
+    .bind_texture = RENDERER_GL.bind_texture,
+    .bind_storage_buffer = RENDERER_GL.bind_storage_buffer,
+    .bind_storage_image = RENDERER_GL.bind_storage_image,
+    .draw = RENDERER_GL.draw,
+    .draw_indexed = RENDERER_GL.draw_indexed,
+    .draw_indirect = RENDERER_GL.draw_indirect,
+    .dispatch = RENDERER_GL.dispatch,
+    .barrier = RENDERER_GL.barrier,
+};
+
+std::optional<Overdraw> overdrawInit(int32_t width, int32_t height) {
+    const ShaderCodes accumulate_shader_codes = {
+        .vert = FULLSCREEN_VERTEX_SHADER,
+        .frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) out vec4 frag_count;"
+        ""
+        "uniform usampler2D u_counter;"
+        ""
+        "void main() {"
+            "frag_count = vec4(float(texelFetch(u_counter, ivec2(gl_FragCoord.xy), 0).r));"
+        "}",
+    };
+    // the offscreen passes all draw at the render size
+    const ShaderCodes accumulate_image_shader_codes = {
+        .vert = SCREEN_VERTEX_SHADER,
+        .frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) in vec2 in_uv;"
+        ""
+        "layout (location = 0) out vec4 frag_count;"
+        ""
+        FRAME_UNIFORMS_GLSL
+        ""
+        "uniform usampler2D u_counter;"
+        ""
+        "void main() {"
+            "ivec2 texel = min(ivec2(in_uv * vec2(u_resolution)), u_resolution - 1);"
+            "frag_count = vec4(float(texelFetch(u_counter, texel, 0).r));"
+        "}",
+    };
+    // black for nothing, then blue, green, yellow, red and white from 8 up
+    const ShaderCodes heatmap_shader_codes = {
+        .vert = FULLSCREEN_VERTEX_SHADER,
+        .frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) out vec4 frag_color;"
+        ""
+        "uniform sampler2D u_total;"
+        ""
+        "const vec3 ramp[6] = vec3[]("
+            "vec3(0.0, 0.0, 0.0),"
+            "vec3(0.0, 0.0, 1.0),"
+            "vec3(0.0, 1.0, 0.0),"
+            "vec3(1.0, 1.0, 0.0),"
+            "vec3(1.0, 0.0, 0.0),"
+            "vec3(1.0, 1.0, 1.0)"
+        ");"
+        ""
+        "void main() {"
+            "float count = texelFetch(u_total, ivec2(gl_FragCoord.xy), 0).r;"
+            "float x = count <= 4.0 ? count : 4.0 + (count - 4.0) / 4.0;"
+            "x = clamp(x, 0.0, 5.0);"
+            "int i = min(int(x), 4);"
+            "frag_color = vec4(mix(ramp[i], ramp[i + 1], x - float(i)), 1.0);"
+        "}",
+    };
+
+    // the programs compiled so far are deleted along with the Overdraw
+    Overdraw overdraw = {
+        .frame = 0,
+    };
+
+    auto accumulate_program = compileShader(accumulate_shader_codes);
+    if (!accumulate_program) {
+        overdrawDeinit(&overdraw);
+        return std::nullopt;
+    }
+    overdraw.accumulate_program = accumulate_program.value();
+
+    auto accumulate_image_program = compileShader(accumulate_image_shader_codes);
+    if (!accumulate_image_program) {
+        overdrawDeinit(&overdraw);
+        return std::nullopt;
+    }
+    overdraw.accumulate_image_program = accumulate_image_program.value();
+
+    auto heatmap_program = compileShader(heatmap_shader_codes);
+    if (!heatmap_program) {
+        overdrawDeinit(&overdraw);
+        return std::nullopt;
+    }
+    overdraw.heatmap_program = heatmap_program.value();
+
+    if (dsaSupported()) {
+        glCreateVertexArrays(1, &overdraw.empty_vert_arr);
+    } else {
+        glGenVertexArrays(1, &overdraw.empty_vert_arr);
+    }
+
+    if (!overdrawResize(&overdraw, width, height)) {
+        overdrawDeinit(&overdraw);
+        return std::nullopt;
+    }
+
+    return overdraw;
+}
+
+bool overdrawResize(Overdraw* p_overdraw, int32_t width, int32_t height) {
+    glStateDeleteFramebuffers(1, &p_overdraw->counter_framebuffer);
+    glStateDeleteTextures(1, &p_overdraw->counter);
+    renderTargetDeinit(&p_overdraw->total);
+    p_overdraw->width = width;
+    p_overdraw->height = height;
+
+    // read as the stencil index, which needs nearest filtering
+    const GLenum draw_buffers[1] = { GL_NONE };
+    GLenum status = GL_NONE;
+    if (dsaSupported()) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &p_overdraw->counter);
+        glTextureStorage2D(p_overdraw->counter, 1, GL_DEPTH24_STENCIL8, width, height);
+        glTextureParameteri(p_overdraw->counter, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_STENCIL_INDEX);
+        glTextureParameteri(p_overdraw->counter, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(p_overdraw->counter, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glCreateFramebuffers(1, &p_overdraw->counter_framebuffer);
+        glNamedFramebufferTexture(p_overdraw->counter_framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, p_overdraw->counter, 0);
+        glNamedFramebufferDrawBuffers(p_overdraw->counter_framebuffer, 1, draw_buffers);
+        status = glCheckNamedFramebufferStatus(p_overdraw->counter_framebuffer, GL_FRAMEBUFFER);
+    } else {
+        glGenTextures(1, &p_overdraw->counter);
+        glStateBindTexture(0, p_overdraw->counter);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_STENCIL_INDEX);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &p_overdraw->counter_framebuffer);
+        glStateBindFramebuffer(GL_FRAMEBUFFER, p_overdraw->counter_framebuffer);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, p_overdraw->counter, 0);
+        glDrawBuffers(1, draw_buffers);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::println("ERR: overdraw counter framebuffer creation failed ({})", status);
+        return false;
+    }
+
+    auto total = renderTargetInit(width, height, GL_R32F);
+    if (!total) return false;
+    p_overdraw->total = total.value();
+
+    return true;
+}
+
+void overdrawBegin(Overdraw* p_overdraw, GLuint vert_arr, int32_t window_width, int32_t window_height) {
+    p_overdraw->frame += 1;
+    p_overdraw->image_vert_arr = vert_arr;
+    p_overdraw->window_width = std::min(window_width, p_overdraw->width);
+    p_overdraw->window_height = std::min(window_height, p_overdraw->height);
+
+    glStateBindFramebuffer(GL_FRAMEBUFFER, p_overdraw->total.framebuffer);
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void overdrawPassBegin(Overdraw* p_overdraw) {
+    g_counting = p_overdraw;
+    p_overdraw->pass_width = 0;
+    p_overdraw->pass_height = 0;
+
+    glStateBindFramebuffer(GL_FRAMEBUFFER, p_overdraw->counter_framebuffer);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+}
+
+// the draws of the pass go to the counter at the size of its target, every
+// fragment adding one (up to 255)
+void overdrawRendererBeginPass(const RendererPass& pass) {
+    g_counting->pass_width = std::min(pass.width, g_counting->width);
+    g_counting->pass_height = std::min(pass.height, g_counting->height);
+    g_counting->pass_to_window = pass.framebuffer == 0;
+
+    glStateBindFramebuffer(GL_FRAMEBUFFER, g_counting->counter_framebuffer);
+    glStateViewport(0, 0, pass.width, pass.height);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 0, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+void overdrawRendererEndPass() {
+    glDisable(GL_STENCIL_TEST);
+    RENDERER_GL.end_pass();
+}
+
+void overdrawPassEnd(Overdraw* p_overdraw, const std::string& pass, bool shown) {
+    g_counting = NULL;
+    // e.g. a compute pass or the blur
+    if (p_overdraw->pass_width == 0) return;
+
+    if (shown) {
+        glStateBindFramebuffer(GL_FRAMEBUFFER, p_overdraw->total.framebuffer);
+        glStateViewport(0, 0, p_overdraw->window_width, p_overdraw->window_height);
+        glStateBlend(true);
+        glStateBlendFunc(GL_ONE, GL_ONE);
+        glStateBindTexture(0, p_overdraw->counter);
+        if (p_overdraw->pass_to_window) {
+            glStateUseProgram(p_overdraw->accumulate_program);
+            glStateBindVertexArray(p_overdraw->empty_vert_arr);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        } else {
+            glStateUseProgram(p_overdraw->accumulate_image_program);
+            glStateBindVertexArray(p_overdraw->image_vert_arr);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(6 * sizeof(GLuint)));
+        }
+        glStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    auto stats = std::find_if(p_overdraw->stats.begin(), p_overdraw->stats.end(), [&pass](const OverdrawStats& stats) {
+        return stats.pass == pass;
+    });
+    if (stats == p_overdraw->stats.end()) {
+        p_overdraw->stats.push_back(OverdrawStats{ .pass = pass, .average = 0.0, .max = 0.0 });
+        stats = p_overdraw->stats.end() - 1;
+    } else if (p_overdraw->frame % OVERDRAW_STATS_INTERVAL != 0) {
+        return;
+    }
+
+    std::vector<GLuint> counts(size_t(p_overdraw->pass_width) * p_overdraw->pass_height);
+    glStateBindFramebuffer(GL_FRAMEBUFFER, p_overdraw->counter_framebuffer);
+    glReadPixels(0, 0, p_overdraw->pass_width, p_overdraw->pass_height, GL_STENCIL_INDEX, GL_UNSIGNED_INT, counts.data());
+
+    double sum = 0.0;
+    GLuint max = 0;
+    for (GLuint count : counts) {
+        sum += count;
+        max = std::max(max, count);
+    }
+    stats->average = counts.empty() ? 0.0 : sum / counts.size();
+    stats->max = float(max);
+}
+
+void overdrawEnd(Overdraw* p_overdraw) {
+    glStateBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glStateViewport(0, 0, p_overdraw->window_width, p_overdraw->window_height);
+    glStateBlend(false);
+
+    glStateUseProgram(p_overdraw->heatmap_program);
+    glStateBindVertexArray(p_overdraw->empty_vert_arr);
+    glStateBindTexture(0, p_overdraw->total.texture);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glStateBlend(true);
+}
+
+void overdrawDeinit(Overdraw* p_overdraw) {
+    glDeleteProgram(p_overdraw->accumulate_program);
+    glDeleteProgram(p_overdraw->accumulate_image_program);
+    glDeleteProgram(p_overdraw->heatmap_program);
+    glStateDeleteVertexArrays(1, &p_overdraw->empty_vert_arr);
+    glStateDeleteFramebuffers(1, &p_overdraw->counter_framebuffer);
+    glStateDeleteTextures(1, &p_overdraw->counter);
+    renderTargetDeinit(&p_overdraw->total);
+
+    p_overdraw->accumulate_program = 0;
+    p_overdraw->accumulate_image_program = 0;
+    p_overdraw->heatmap_program = 0;
+    p_overdraw->empty_vert_arr = 0;
+    p_overdraw->counter_framebuffer = 0;
+    p_overdraw->counter = 0;
+    p_overdraw->stats.clear();
+}
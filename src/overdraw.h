@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "renderer.h"
+#include "resources.h"
+
+// read the counters back every this many frames, it stalls the pipeline
+#define OVERDRAW_STATS_INTERVAL 15
+
+struct OverdrawStats {
+    std::string pass;
+    // fragments per pixel over the whole target of the pass
+    float average;
+    float max;
+};
+
+// Debug view counting the fragments every pass shades per pixel. The passes
+// run again through RENDERER_OVERDRAW, which sends their draws, with their
+// own programs and geometry, into a stencil buffer every fragment increments
+// instead of their targets. The passes picked are summed into a float target
+// shown as a heatmap over the window. Fragments a shader discards are not
+// counted, nor is what is drawn without the renderer (the blur pyramids).
+struct Overdraw {
+    // add the counter of a pass drawing onto the window, and of an offscreen
+    // pass through the image quad it is shown with
+    GLuint accumulate_program;
+    GLuint accumulate_image_program;
+    GLuint heatmap_program;
+    // the full screen passes use gl_VertexID only
+    GLuint empty_vert_arr;
+    // the texture vertex array, whose image quad puts the offscreen passes
+    // on the window
+    GLuint image_vert_arr;
+    // the stencil of one pass at a time, as large as the window and the
+    // offscreen targets, which start in its corner
+    GLuint counter_framebuffer;
+    GLuint counter;
+    int32_t width;
+    int32_t height;
+    // the passes picked for the heatmap, in window pixels
+    RenderTarget total;
+    int32_t window_width;
+    int32_t window_height;
+    // the target of the pass being counted, 0 until it draws
+    int32_t pass_width;
+    int32_t pass_height;
+    bool pass_to_window;
+
+    std::vector<OverdrawStats> stats;
+    uint32_t frame;
+};
+
+// draws through RENDERER_GL into the counter of the Overdraw between
+// overdrawPassBegin and overdrawPassEnd
+extern const Renderer RENDERER_OVERDRAW;
+
+// width and height cover the window and the offscreen targets
+std::optional<Overdraw> overdrawInit(int32_t width, int32_t height);
+bool overdrawResize(Overdraw* p_overdraw, int32_t width, int32_t height);
+// clears the total, vert_arr is the texture vertex array
+void overdrawBegin(Overdraw* p_overdraw, GLuint vert_arr, int32_t window_width, int32_t window_height);
+// the passes then run with RENDERER_OVERDRAW
+void overdrawPassBegin(Overdraw* p_overdraw);
+// if the pass drew anything, adds its counter to the total when shown and
+// updates its stats
+void overdrawPassEnd(Overdraw* p_overdraw, const std::string& pass, bool shown);
+// draws the heatmap of the total over the window
+void overdrawEnd(Overdraw* p_overdraw);
+void overdrawDeinit(Overdraw* p_overdraw);
@@ -0,0 +1,233 @@
+#include "playlist.h"
+
+#include <glad/gl.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+#include "resources.h"
+#include "virtual_texture.h"
+
+std::optional<PlaylistImage> loadImage(const std::string& filename, int32_t width, int32_t height, int32_t level_count);
+std::vector<unsigned char> resampleCover(const unsigned char* pixels, int32_t width, int32_t height, int32_t out_width, int32_t out_height);
+void startLoading(Playlist* p_playlist, size_t entry);
+bool uploadSlice(Playlist* p_playlist, int32_t layer, size_t budget);
+
+std::optional<Playlist> playlistInit(const std::vector<std::string>& files, float interval, int32_t max_size) {
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t channels = 0;
+    if (!stbi_info(files[0].c_str(), &width, &height, &channels)) {
+        std::println("ERR: Failed to load image \"{}\": {}", files[0], stbi_failure_reason());
+        return std::nullopt;
+    }
+    if (width > max_size || height > max_size) {
+        const float scale = float(max_size) / float(std::max(width, height));
+        width = std::clamp(int32_t(std::round(scale * width)), 1, max_size);
+        height = std::clamp(int32_t(std::round(scale * height)), 1, max_size);
+    }
+
+    Playlist playlist = {
+        .files = files,
+        .interval = interval,
+        .width = width,
+        .height = height,
+        .level_count = renderTargetLevels(width, height),
+        .texture = 0,
+        .fade_start = -1.0,
+    };
+    if (dsaSupported()) {
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &playlist.texture);
+        glTextureStorage3D(playlist.texture, playlist.level_count, GL_RGBA8, width, height, PLAYLIST_LAYERS);
+        glTextureParameteri(playlist.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(playlist.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(playlist.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(playlist.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    } else {
+        glGenTextures(1, &playlist.texture);
+        glStateBindTexture(0, playlist.texture, GL_TEXTURE_2D_ARRAY);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, playlist.level_count, GL_RGBA8, width, height, PLAYLIST_LAYERS);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    // the first image is needed before the first frame, so it is loaded here
+    // and uploaded whole
+    playlist.uploading = loadImage(files[0], width, height, playlist.level_count);
+    if (!playlist.uploading) {
+        playlistDeinit(&playlist);
+        return std::nullopt;
+    }
+    uploadSlice(&playlist, playlist.shown_layer, SIZE_MAX);
+    playlist.uploading = std::nullopt;
+
+    startLoading(&playlist, 1 % files.size());
+    std::println("INFO: Playlist of {} images at {}x{}", files.size(), width, height);
+    return playlist;
+}
+
+// runs on the loader thread, without touching GL
+std::optional<PlaylistImage> loadImage(const std::string& filename, int32_t width, int32_t height, int32_t level_count) {
+    // the flag is global otherwise, and the main thread loads images too
+    stbi_set_flip_vertically_on_load_thread(true);
+    int32_t x, y, n;
+    unsigned char* pixels = stbi_load(filename.c_str(), &x, &y, &n, 4);
+    if (pixels == NULL) {
+        std::println("ERR: Failed to load image \"{}\": {}", filename, stbi_failure_reason());
+        return std::nullopt;
+    }
+
+    PlaylistImage image = {};
+    if (x == width && y == height) {
+        image.levels.emplace_back(pixels, pixels + 4 * size_t(x) * y);
+    } else {
+        image.levels.push_back(resampleCover(pixels, x, y, width, height));
+    }
+    stbi_image_free(pixels);
+
+    for (int32_t l = 1; l < level_count; l++) {
+        image.levels.push_back(downsample(
+            image.levels[l - 1].data(),
+            std::max(1, width >> (l - 1)), std::max(1, height >> (l - 1)),
+            std::max(1, width >> l), std::max(1, height >> l)
+        ));
+    }
+    return image;
+}
+
+// scales the image to cover the output keeping its aspect ratio, filtering
+// bilinearly, and crops what sticks out on either side
+std::vector<unsigned char> resampleCover(const unsigned char* pixels, int32_t width, int32_t height, int32_t out_width, int32_t out_height) {
+    const float scale = std::max(float(out_width) / width, float(out_height) / height);
+    const float offset_x = 0.5f * (width - out_width / scale);
+    const float offset_y = 0.5f * (height - out_height / scale);
+
+    std::vector<unsigned char> out(4 * size_t(out_width) * out_height);
+    for (int32_t y = 0; y < out_height; y++) {
+        const float sy = offset_y + (y + 0.5f) / scale - 0.5f;
+        const float fy = sy - std::floor(sy);
+        const int32_t y0 = std::clamp(int32_t(std::floor(sy)), 0, height - 1);
+        const int32_t y1 = std::clamp(int32_t(std::floor(sy)) + 1, 0, height - 1);
+        for (int32_t x = 0; x < out_width; x++) {
+            const float sx = offset_x + (x + 0.5f) / scale - 0.5f;
+            const float fx = sx - std::floor(sx);
+            const int32_t x0 = std::clamp(int32_t(std::floor(sx)), 0, width - 1);
+            const int32_t x1 = std::clamp(int32_t(std::floor(sx)) + 1, 0, width - 1);
+            for (int32_t c = 0; c < 4; c++) {
+                const float top = (1.0f - fx) * pixels[4 * (size_t(y0) * width + x0) + c]
+                    + fx * pixels[4 * (size_t(y0) * width + x1) + c];
+                const float bottom = (1.0f - fx) * pixels[4 * (size_t(y1) * width + x0) + c]
+                    + fx * pixels[4 * (size_t(y1) * width + x1) + c];
+                out[4 * (size_t(y) * out_width + x) + c] = (unsigned char)(std::round((1.0f - fy) * top + fy * bottom));
+            }
+        }
+    }
+    return out;
+}
+
+void startLoading(Playlist* p_playlist, size_t entry) {
+    p_playlist->next_entry = entry;
+    p_playlist->loading = std::async(
+        std::launch::async, loadImage,
+        p_playlist->files[entry], p_playlist->width, p_playlist->height, p_playlist->level_count
+    );
+}
+
+// uploads rows of the image being uploaded, level after level, until the
+// budget is spent (at least one row), returns true once all of it is in
+bool uploadSlice(Playlist* p_playlist, int32_t layer, size_t budget) {
+    const PlaylistImage& image = p_playlist->uploading.value();
+    size_t uploaded = 0;
+    while (p_playlist->upload_level < p_playlist->level_count) {
+        const int32_t level = p_playlist->upload_level;
+        const int32_t width = std::max(1, p_playlist->width >> level);
+        const int32_t height = std::max(1, p_playlist->height >> level);
+        const size_t row_bytes = 4 * size_t(width);
+        if (uploaded > 0 && uploaded + row_bytes > budget) return false;
+
+        const size_t fit = std::max<size_t>((budget - uploaded) / row_bytes, 1);
+        const int32_t rows = int32_t(std::min<size_t>(fit, height - p_playlist->upload_row));
+        const unsigned char* data = image.levels[level].data() + row_bytes * p_playlist->upload_row;
+        if (dsaSupported()) {
+            glTextureSubImage3D(p_playlist->texture, level, 0, p_playlist->upload_row, layer, width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        } else {
+            glStateBindTexture(0, p_playlist->texture, GL_TEXTURE_2D_ARRAY);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, p_playlist->upload_row, layer, width, rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        }
+        uploaded += rows * row_bytes;
+
+        p_playlist->upload_row += rows;
+        if (p_playlist->upload_row == height) {
+            p_playlist->upload_level += 1;
+            p_playlist->upload_row = 0;
+        }
+    }
+    p_playlist->upload_level = 0;
+    return true;
+}
+
+bool playlistUpdate(Playlist* p_playlist, double time) {
+    if (p_playlist->fade_start >= 0.0) {
+        p_playlist->fade = float(std::min((time - p_playlist->fade_start) / PLAYLIST_FADE_SECONDS, 1.0));
+        if (p_playlist->fade >= 1.0f) {
+            p_playlist->shown_layer = 1 - p_playlist->shown_layer;
+            p_playlist->shown_entry = p_playlist->next_entry;
+            p_playlist->shown_since = time;
+            p_playlist->next_ready = false;
+            p_playlist->fade_start = -1.0;
+            p_playlist->fade = 0.0;
+            startLoading(p_playlist, (p_playlist->shown_entry + 1) % p_playlist->files.size());
+        }
+        return true;
+    }
+
+    if (p_playlist->loading.valid()
+        && p_playlist->loading.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+    ) {
+        p_playlist->uploading = p_playlist->loading.get();
+        // images that fail to load are skipped
+        if (!p_playlist->uploading) {
+            startLoading(p_playlist, (p_playlist->next_entry + 1) % p_playlist->files.size());
+        }
+    }
+    if (p_playlist->uploading && uploadSlice(p_playlist, 1 - p_playlist->shown_layer, PLAYLIST_UPLOAD_BYTES)) {
+        p_playlist->uploading = std::nullopt;
+        p_playlist->next_ready = true;
+    }
+
+    if (p_playlist->next_ready && time - p_playlist->shown_since >= p_playlist->interval) {
+        std::println("INFO: Fading to \"{}\"", p_playlist->files[p_playlist->next_entry]);
+        p_playlist->fade_start = time;
+        p_playlist->fade = 0.0;
+        return true;
+    }
+    return false;
+}
+
+void playlistBind(const Playlist& playlist, GLuint program) {
+    glStateUseProgram(program);
+    glUniform2i(uniformLocation(program, UNIFORM_LAYERS), playlist.shown_layer, 1 - playlist.shown_layer);
+    glUniform1f(uniformLocation(program, UNIFORM_FADE), playlist.fade);
+    glStateBindTexture(0, playlist.texture, GL_TEXTURE_2D_ARRAY);
+}
+
+void playlistDeinit(Playlist* p_playlist) {
+    // an image still loading is waited for
+    if (p_playlist->loading.valid()) p_playlist->loading.wait();
+    p_playlist->loading = {};
+    p_playlist->uploading = std::nullopt;
+    glStateDeleteTextures(1, &p_playlist->texture);
+    p_playlist->texture = 0;
+    p_playlist->files.clear();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <string>
+#include <vector>
+
+// the layer shown and the one the next image is uploaded into
+#define PLAYLIST_LAYERS 2
+// bytes of the next image uploaded per frame, so loading never hitches
+#define PLAYLIST_UPLOAD_BYTES (1 << 20)
+#define PLAYLIST_FADE_SECONDS 2.0
+
+// an image of the playlist decoded and scaled to the size of the texture
+// array, with its mip chain
+struct PlaylistImage {
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// Images shown in turn, crossfading from one to the next. They share one
+// mip-mapped texture array the size of the first image (the others are
+// scaled to cover it and cropped), so the render targets and passes never
+// change. The next image is decoded on another thread while the current
+// one is shown, then uploaded into the other layer a slice per frame.
+struct Playlist {
+    std::vector<std::string> files;
+    // seconds each image is shown before fading to the next
+    float interval;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    GLuint texture;
+
+    int32_t shown_layer;
+    size_t shown_entry;
+    double shown_since;
+    // the image loaded into the other layer, ready once fully uploaded
+    size_t next_entry;
+    bool next_ready;
+    // negative when not fading
+    double fade_start;
+    float fade;
+
+    std::future<std::optional<PlaylistImage>> loading;
+    std::optional<PlaylistImage> uploading;
+    int32_t upload_level;
+    int32_t upload_row;
+};
+
+// decodes the first image right away, max_size limits the texture array
+std::optional<Playlist> playlistInit(const std::vector<std::string>& files, float interval, int32_t max_size);
+// Advances the loading and the fades, returns true when the image drawn
+// changed.
+bool playlistUpdate(Playlist* p_playlist, double time);
+// binds the texture array to texture unit 0 and sets the uniforms of the
+// playlist shader
+void playlistBind(const Playlist& playlist, GLuint program);
+void playlistDeinit(Playlist* p_playlist);
@@ -0,0 +1,173 @@
+#include "post_process.h"
+
+#include <glad/gl.h>
+
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+#include "resources.h"
+
+std::optional<GLuint> postStageInit(const std::vector<size_t>& effects, bool layered, bool last);
+
+const PostEffect POST_EFFECTS[POST_EFFECT_COUNT] = {
+    {
+        // cooler and a little less saturated, like an overcast day
+        .name = "grade",
+        .code =
+        "vec4 grade(vec4 color, vec2 uv) {"
+            "float luma = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));"
+            "vec3 graded = mix(vec3(luma), color.rgb, 0.85);"
+            "graded = (graded - 0.5) * 1.1 + 0.5;"
+            "graded *= vec3(0.95, 1.0, 1.08);"
+            "return vec4(clamp(graded, 0.0, 1.0), color.a);"
+        "}",
+        .neighborhood = false,
+    },
+    {
+        // haze thickening towards the top of the image
+        .name = "fog",
+        .code =
+        "vec4 fog(vec4 color, vec2 uv) {"
+            "float amount = 0.3 * smoothstep(0.2, 1.0, uv.y);"
+            "return vec4(mix(color.rgb, vec3(0.62, 0.66, 0.7), amount), color.a);"
+        "}",
+        .neighborhood = false,
+    },
+    {
+        // unsharp mask against the four direct neighbours
+        .name = "sharpen",
+        .code =
+        "vec4 sharpen(vec4 color, vec2 uv) {"
+            "vec2 texel = 1.0 / vec2(textureSize(u_texture, 0));"
+            "vec4 centre = source(uv);"
+            "vec4 blurred = source(uv + vec2(texel.x, 0.0));"
+            "blurred += source(uv - vec2(texel.x, 0.0));"
+            "blurred += source(uv + vec2(0.0, texel.y));"
+            "blurred += source(uv - vec2(0.0, texel.y));"
+            "vec3 sharpened = centre.rgb + 0.6 * (centre.rgb - blurred.rgb / 4.0);"
+            "return vec4(clamp(sharpened, 0.0, 1.0), centre.a);"
+        "}",
+        .neighborhood = true,
+    },
+    {
+        .name = "vignette",
+        .code =
+        "vec4 vignette(vec4 color, vec2 uv) {"
+            "float falloff = smoothstep(0.85, 0.3, length(uv - 0.5));"
+            "return vec4(color.rgb * mix(0.5, 1.0, falloff), color.a);"
+        "}",
+        .neighborhood = false,
+    },
+    {
+        // new noise 24 times a second, per window pixel
+        .name = "grain",
+        .code =
+        "vec4 grain(vec4 color, vec2 uv) {"
+            "vec3 seed = vec3(gl_FragCoord.xy, floor(u_time * 24.0));"
+            "float noise = fract(sin(dot(seed, vec3(12.9898, 78.233, 37.719))) * 43758.5453);"
+            "return vec4(color.rgb + (noise - 0.5) * 0.06, color.a);"
+        "}",
+        .neighborhood = false,
+    },
+};
+
+std::optional<size_t> postEffectIndex(const std::string& name) {
+    for (size_t i = 0; i < POST_EFFECT_COUNT; i++) {
+        if (name == POST_EFFECTS[i].name) return i;
+    }
+    return std::nullopt;
+}
+
+std::optional<PostChain> postChainInit(const std::vector<size_t>& effects, bool layered) {
+    std::vector<std::vector<size_t>> stage_effects = {{}};
+    for (size_t effect : effects) {
+        if (POST_EFFECTS[effect].neighborhood && !stage_effects.back().empty()) {
+            stage_effects.push_back({});
+        }
+        stage_effects.back().push_back(effect);
+    }
+
+    PostChain chain = {
+        .effects = effects,
+    };
+    for (size_t i = 0; i < stage_effects.size(); i++) {
+        auto stage = postStageInit(stage_effects[i], layered && i == 0, i + 1 == stage_effects.size());
+        if (!stage) {
+            postChainDeinit(&chain);
+            return std::nullopt;
+        }
+        chain.stages.push_back(stage.value());
+
+        std::string names;
+        for (size_t effect : stage_effects[i]) names += std::string(" ") + POST_EFFECTS[effect].name;
+        std::println("INFO: post-processing stage {}:{}", i, names.empty() ? " none" : names);
+    }
+    if (dsaSupported()) {
+        glCreateVertexArrays(1, &chain.empty_vert_arr);
+    } else {
+        glGenVertexArrays(1, &chain.empty_vert_arr);
+    }
+
+    return chain;
+}
+
+// Generates the fragment shader running the effects one after another on
+// the stage input, the last stage premultiplies its output for the window.
+std::optional<GLuint> postStageInit(const std::vector<size_t>& effects, bool layered, bool last) {
+    std::string frag =
+        "#version 430 core\n"
+        ""
+        "layout (location = 0) in vec2 in_uv;"
+        ""
+        "layout (location = 0) out vec4 frag_color;"
+        ""
+        FRAME_UNIFORMS_GLSL
+        ""
+        "uniform sampler2D u_texture;";
+    if (layered) {
+        frag +=
+        "uniform sampler2D u_rain;"
+        ""
+        "vec4 source(vec2 uv) {"
+            "vec4 color = texture(u_texture, uv);"
+            "vec4 rain = texture(u_rain, uv);"
+            "vec4 over = vec4(rain.rgb + color.rgb*color.a*(1.0 - rain.a), rain.a + color.a*(1.0 - rain.a));"
+            "return over.a > 0.0 ? vec4(over.rgb / over.a, over.a) : vec4(0.0);"
+        "}";
+    } else {
+        frag +=
+        "vec4 source(vec2 uv) {"
+            "return texture(u_texture, uv);"
+        "}";
+    }
+    for (size_t effect : effects) frag += POST_EFFECTS[effect].code;
+
+    frag +=
+        "void main() {"
+            "vec4 color = source(in_uv);";
+    for (size_t effect : effects) frag += std::string("color = ") + POST_EFFECTS[effect].name + "(color, in_uv);";
+    frag += last
+        ? "frag_color = vec4(color.rgb * color.a, color.a);"
+          "}"
+        : "frag_color = color;"
+          "}";
+
+    const ShaderCodes codes = {
+        .vert = last ? SCREEN_VERTEX_SHADER : FULLSCREEN_VERTEX_SHADER,
+        .frag = frag.c_str(),
+    };
+    return compileShader(codes);
+}
+
+void postChainDeinit(PostChain* p_chain) {
+    for (GLuint stage : p_chain->stages) {
+        glDeleteProgram(stage);
+    }
+    glStateDeleteVertexArrays(1, &p_chain->empty_vert_arr);
+    p_chain->effects.clear();
+    p_chain->stages.clear();
+    p_chain->empty_vert_arr = 0;
+}
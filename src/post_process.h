@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// An effect is a GLSL function "vec4 <name>(vec4 color, vec2 uv)" taking and
+// returning straight (not premultiplied) color. Point-wise effects only look
+// at the color they are given, neighborhood effects ignore it and read the
+// input of their stage around uv with "vec4 source(vec2 uv)" instead.
+struct PostEffect {
+    const char* name;
+    const GLchar* code;
+    bool neighborhood;
+};
+
+#define POST_EFFECT_COUNT 5
+extern const PostEffect POST_EFFECTS[POST_EFFECT_COUNT];
+
+// A chain of effects (indices into POST_EFFECTS, applied in order) compiled
+// into as few fragment shaders as possible. Effects are fused into one stage
+// until a neighborhood effect needs the output of the ones before it, which
+// then starts a new stage reading the texture the previous stage rendered.
+// The last stage draws the image onto the window, so a chain of point-wise
+// effects costs no pass of its own.
+struct PostChain {
+    std::vector<size_t> effects;
+    // each stage reads the texture on unit 0 (the first one also the
+    // premultiplied layer on unit 1 to put over it, when layered), the ones
+    // before the last render a full target, the last one draws the image
+    // quad with premultiplied output
+    std::vector<GLuint> stages;
+    // the stages before the last use gl_VertexID only
+    GLuint empty_vert_arr;
+};
+
+std::optional<size_t> postEffectIndex(const std::string& name);
+// layered when the first stage reads two layers (e.g. the background and the
+// rain) instead of a single opaque image
+std::optional<PostChain> postChainInit(const std::vector<size_t>& effects, bool layered);
+void postChainDeinit(PostChain* p_chain);
@@ -0,0 +1,330 @@
+#include "render_graph.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+bool passReads(const RenderGraphPass& pass, RenderGraphHandle handle);
+bool passWrites(const RenderGraphPass& pass, RenderGraphHandle handle);
+bool passDependsOn(const RenderGraph& graph, size_t pass, size_t dependency);
+std::vector<bool> cullPasses(const RenderGraph& graph);
+std::optional<std::vector<size_t>> orderPasses(const RenderGraph& graph, const std::vector<bool>& live);
+bool allocateTargets(RenderGraph* p_graph);
+
+RenderGraphHandle renderGraphCreateTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format) {
+    return renderGraphCreateScaledTexture(p_graph, name, width, height, 1, format);
+}
+
+RenderGraphHandle renderGraphCreateScaledTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, int32_t divisor, GLenum format) {
+    p_graph->textures.push_back(RenderGraphTexture{
+        .name = name,
+        .width = (width + divisor - 1) / divisor,
+        .height = (height + divisor - 1) / divisor,
+        .format = format,
+        .divisor = divisor,
+        .imported = std::nullopt,
+        .mipmapped = false,
+        .persistent = false,
+        .valid = false,
+        .target = std::nullopt,
+    });
+    return p_graph->textures.size() - 1;
+}
+
+RenderGraphHandle renderGraphCreatePersistentTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format) {
+    RenderGraphHandle handle = renderGraphCreateTexture(p_graph, name, width, height, format);
+    p_graph->textures[handle].persistent = true;
+    return handle;
+}
+
+RenderGraphHandle renderGraphCreatePyramid(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format, bool persistent) {
+    RenderGraphHandle handle = renderGraphCreateScaledTexture(p_graph, name, width, height, 2, format);
+    p_graph->textures[handle].mipmapped = true;
+    p_graph->textures[handle].persistent = persistent;
+    return handle;
+}
+
+RenderGraphHandle renderGraphImportTarget(RenderGraph* p_graph, const std::string& name, RenderTarget target) {
+    p_graph->textures.push_back(RenderGraphTexture{
+        .name = name,
+        .width = target.width,
+        .height = target.height,
+        .format = GL_NONE,
+        .divisor = 1,
+        .imported = target,
+        .mipmapped = false,
+        .persistent = false,
+        .valid = false,
+        .target = std::nullopt,
+    });
+    return p_graph->textures.size() - 1;
+}
+
+void renderGraphAddPass(
+    RenderGraph* p_graph,
+    const std::string& name,
+    std::vector<RenderGraphHandle> reads,
+    std::vector<RenderGraphHandle> writes,
+    RenderGraphExecute execute
+) {
+    p_graph->passes.push_back(RenderGraphPass{
+        .name = name,
+        .reads = std::move(reads),
+        .writes = std::move(writes),
+        .execute = std::move(execute),
+    });
+}
+
+bool renderGraphCompile(RenderGraph* p_graph) {
+    std::vector<bool> live = cullPasses(*p_graph);
+
+    auto order = orderPasses(*p_graph, live);
+    if (!order) {
+        std::println("ERR: render graph has a dependency cycle");
+        return false;
+    }
+    p_graph->order = order.value();
+
+    for (size_t i = 0; i < p_graph->passes.size(); i++) {
+        if (!live[i]) std::println("INFO: render graph culled pass \"{}\"", p_graph->passes[i].name);
+    }
+
+    return allocateTargets(p_graph);
+}
+
+bool renderGraphResize(RenderGraph* p_graph, int32_t width, int32_t height) {
+    for (RenderTarget& target : p_graph->targets) {
+        renderTargetDeinit(&target);
+    }
+    p_graph->targets.clear();
+
+    for (RenderGraphTexture& texture : p_graph->textures) {
+        if (texture.imported) continue;
+        texture.width = (width + texture.divisor - 1) / texture.divisor;
+        texture.height = (height + texture.divisor - 1) / texture.divisor;
+        texture.valid = false;
+        texture.target = std::nullopt;
+    }
+
+    return allocateTargets(p_graph);
+}
+
+void renderGraphExecute(RenderGraph* p_graph, const RenderGraphFrame& frame) {
+    std::vector<bool> updated(p_graph->textures.size(), false);
+    p_graph->frame_bytes = 0;
+    for (size_t i : p_graph->order) {
+        const RenderGraphPass& pass = p_graph->passes[i];
+
+        bool cached = true;
+        for (RenderGraphHandle handle : pass.writes) {
+            const RenderGraphTexture& texture = p_graph->textures[handle];
+            if (!texture.persistent || !texture.valid) cached = false;
+        }
+        for (RenderGraphHandle handle : pass.reads) {
+            if (!p_graph->textures[handle].persistent || updated[handle]) cached = false;
+        }
+        if (cached) continue;
+
+        pass.execute(*p_graph, frame);
+
+        for (const std::vector<RenderGraphHandle>* handles : {&pass.reads, &pass.writes}) {
+            for (RenderGraphHandle handle : *handles) {
+                const RenderGraphTexture& texture = p_graph->textures[handle];
+                auto format = renderTargetFormat(texture.format);
+                if (texture.imported || !format) continue;
+                size_t bytes = size_t(texture.width) * texture.height * format->bytes_per_pixel;
+                // a mip chain adds a third
+                if (texture.mipmapped) bytes += bytes / 3;
+                p_graph->frame_bytes += bytes;
+            }
+        }
+
+        for (RenderGraphHandle handle : pass.writes) {
+            p_graph->textures[handle].valid = true;
+            updated[handle] = true;
+        }
+    }
+}
+
+void renderGraphInvalidate(RenderGraph* p_graph, RenderGraphHandle handle) {
+    p_graph->textures[handle].valid = false;
+}
+
+RenderTarget renderGraphTarget(const RenderGraph& graph, RenderGraphHandle handle) {
+    const RenderGraphTexture& texture = graph.textures[handle];
+    if (texture.imported) return texture.imported.value();
+    if (texture.target) return graph.targets[texture.target.value()];
+    return RenderTarget{};
+}
+
+void renderGraphDeinit(RenderGraph* p_graph) {
+    for (RenderTarget& target : p_graph->targets) {
+        renderTargetDeinit(&target);
+    }
+    p_graph->targets.clear();
+    p_graph->order.clear();
+    p_graph->passes.clear();
+    p_graph->textures.clear();
+}
+
+bool passReads(const RenderGraphPass& pass, RenderGraphHandle handle) {
+    return std::find(pass.reads.begin(), pass.reads.end(), handle) != pass.reads.end();
+}
+
+bool passWrites(const RenderGraphPass& pass, RenderGraphHandle handle) {
+    return std::find(pass.writes.begin(), pass.writes.end(), handle) != pass.writes.end();
+}
+
+// A reader sees a texture after all of its writers. Passes that both read and
+// write the same texture (e.g. blending on top of it) run in declaration order.
+bool passDependsOn(const RenderGraph& graph, size_t pass, size_t dependency) {
+    if (pass == dependency) return false;
+
+    const RenderGraphPass& p = graph.passes[pass];
+    const RenderGraphPass& d = graph.passes[dependency];
+    for (RenderGraphHandle handle : p.reads) {
+        if (!passWrites(d, handle)) continue;
+
+        bool both_modify = passWrites(p, handle) && passReads(d, handle);
+        if (!both_modify || dependency < pass) return true;
+    }
+    return false;
+}
+
+// Passes writing an imported texture are the roots, everything else is live
+// only if a live pass reads one of its outputs.
+std::vector<bool> cullPasses(const RenderGraph& graph) {
+    const size_t count = graph.passes.size();
+    std::vector<bool> live(count, false);
+    std::vector<size_t> stack;
+
+    for (size_t i = 0; i < count; i++) {
+        for (RenderGraphHandle handle : graph.passes[i].writes) {
+            if (graph.textures[handle].imported) {
+                live[i] = true;
+                stack.push_back(i);
+                break;
+            }
+        }
+    }
+
+    while (!stack.empty()) {
+        size_t pass = stack.back();
+        stack.pop_back();
+        for (size_t i = 0; i < count; i++) {
+            if (!live[i] && passDependsOn(graph, pass, i)) {
+                live[i] = true;
+                stack.push_back(i);
+            }
+        }
+    }
+
+    return live;
+}
+
+// Kahn's algorithm, picking the earliest declared ready pass so independent
+// passes keep the order they were added in.
+std::optional<std::vector<size_t>> orderPasses(const RenderGraph& graph, const std::vector<bool>& live) {
+    const size_t count = graph.passes.size();
+    std::vector<size_t> pending(count, 0);
+    size_t live_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!live[i]) continue;
+        live_count += 1;
+        for (size_t j = 0; j < count; j++) {
+            if (live[j] && passDependsOn(graph, i, j)) pending[i] += 1;
+        }
+    }
+
+    std::vector<size_t> order;
+    std::vector<bool> done(count, false);
+    while (order.size() < live_count) {
+        size_t next = count;
+        for (size_t i = 0; i < count; i++) {
+            if (live[i] && !done[i] && pending[i] == 0) {
+                next = i;
+                break;
+            }
+        }
+        if (next == count) return std::nullopt;
+
+        done[next] = true;
+        order.push_back(next);
+        for (size_t i = 0; i < count; i++) {
+            if (live[i] && !done[i] && passDependsOn(graph, i, next)) pending[i] -= 1;
+        }
+    }
+
+    return order;
+}
+
+// Textures whose lifetimes (first to last use in execution order) do not
+// overlap share a render target when their size and format match. Persistent
+// textures live for the whole frame (and the next one) so they never share.
+bool allocateTargets(RenderGraph* p_graph) {
+    struct Lifetime {
+        RenderGraphHandle handle;
+        size_t first;
+        size_t last;
+    };
+    std::vector<Lifetime> lifetimes;
+    for (RenderGraphHandle handle = 0; handle < p_graph->textures.size(); handle++) {
+        if (p_graph->textures[handle].imported) continue;
+
+        std::optional<Lifetime> lifetime = std::nullopt;
+        for (size_t step = 0; step < p_graph->order.size(); step++) {
+            const RenderGraphPass& pass = p_graph->passes[p_graph->order[step]];
+            if (!passReads(pass, handle) && !passWrites(pass, handle)) continue;
+
+            if (!lifetime) lifetime = Lifetime{ .handle = handle, .first = step, .last = step };
+            lifetime->last = step;
+        }
+        if (lifetime && p_graph->textures[handle].persistent) {
+            lifetime->first = 0;
+            lifetime->last = SIZE_MAX;
+        }
+        if (lifetime) lifetimes.push_back(lifetime.value());
+    }
+    std::sort(lifetimes.begin(), lifetimes.end(), [](const Lifetime& a, const Lifetime& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<size_t> target_last_use;
+    for (const Lifetime& lifetime : lifetimes) {
+        RenderGraphTexture& texture = p_graph->textures[lifetime.handle];
+        const int32_t levels = texture.mipmapped ? renderTargetLevels(texture.width, texture.height) : 1;
+
+        for (size_t i = 0; i < p_graph->targets.size(); i++) {
+            const RenderTarget& target = p_graph->targets[i];
+            if (target_last_use[i] < lifetime.first
+                && target.width == texture.width
+                && target.height == texture.height
+                && target.format == texture.format
+                && target.levels == levels
+            ) {
+                texture.target = i;
+                target_last_use[i] = lifetime.last;
+                break;
+            }
+        }
+        if (texture.target) {
+            std::println("INFO: render graph aliased \"{}\" onto target {}", texture.name, texture.target.value());
+            continue;
+        }
+
+        auto target = renderTargetInit(texture.width, texture.height, texture.format, levels);
+        if (!target) {
+            return false;
+        }
+        texture.target = p_graph->targets.size();
+        p_graph->targets.push_back(target.value());
+        target_last_use.push_back(lifetime.last);
+    }
+
+    return true;
+}
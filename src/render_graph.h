@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "resources.h"
+
+// index into RenderGraph::textures
+typedef size_t RenderGraphHandle;
+
+struct RenderGraphFrame {
+    int scr_width;
+    int scr_height;
+    uint32_t rain_count;
+    float time;
+    // the part of the image the targets hold, see FrameUniforms
+    glm::vec4 view;
+};
+
+struct RenderGraph;
+
+typedef std::function<void(const RenderGraph& graph, const RenderGraphFrame& frame)> RenderGraphExecute;
+
+struct RenderGraphTexture {
+    std::string name;
+    int32_t width;
+    int32_t height;
+    GLenum format;
+    // the texture is 1/divisor of the size the graph is resized to
+    int32_t divisor;
+    // owned by someone else (e.g. the window), never aliased and always kept alive
+    std::optional<RenderTarget> imported;
+    // has a full mip chain, which its writer fills
+    bool mipmapped;
+    // keeps its contents between frames, its writers only run while it is invalid
+    bool persistent;
+    bool valid;
+    // index into RenderGraph::targets, assigned by renderGraphCompile
+    std::optional<size_t> target;
+};
+
+struct RenderGraphPass {
+    std::string name;
+    std::vector<RenderGraphHandle> reads;
+    std::vector<RenderGraphHandle> writes;
+    RenderGraphExecute execute;
+};
+
+struct RenderGraph {
+    std::vector<RenderGraphTexture> textures;
+    std::vector<RenderGraphPass> passes;
+
+    // filled by renderGraphCompile
+    std::vector<size_t> order;
+    std::vector<RenderTarget> targets;
+
+    // estimated bytes the passes that ran last frame read and wrote, counting
+    // every texture they touch once in full
+    size_t frame_bytes;
+};
+
+// Transient textures have undefined contents when their first writer runs,
+// since they may share memory with an earlier texture of the same size and format.
+RenderGraphHandle renderGraphCreateTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format);
+// A transient texture at 1/divisor of the given size (rounded up), kept at that
+// fraction on resize.
+RenderGraphHandle renderGraphCreateScaledTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, int32_t divisor, GLenum format);
+// A pass whose outputs are all persistent and valid, and whose inputs are
+// persistent and were not re-rendered this frame, is skipped.
+RenderGraphHandle renderGraphCreatePersistentTexture(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format);
+// A texture at half the given size with a full mip chain, for a blur pyramid
+// of a texture of that size. Kept at half size on resize.
+RenderGraphHandle renderGraphCreatePyramid(RenderGraph* p_graph, const std::string& name, int32_t width, int32_t height, GLenum format, bool persistent);
+RenderGraphHandle renderGraphImportTarget(RenderGraph* p_graph, const std::string& name, RenderTarget target);
+void renderGraphAddPass(
+    RenderGraph* p_graph,
+    const std::string& name,
+    std::vector<RenderGraphHandle> reads,
+    std::vector<RenderGraphHandle> writes,
+    RenderGraphExecute execute
+);
+// orders the passes, culls the ones that do not contribute to an imported
+// texture and allocates (aliased) render targets for the transient textures
+bool renderGraphCompile(RenderGraph* p_graph);
+// reallocates every non-imported texture at the new size, persistent ones are invalidated
+bool renderGraphResize(RenderGraph* p_graph, int32_t width, int32_t height);
+void renderGraphExecute(RenderGraph* p_graph, const RenderGraphFrame& frame);
+// forces the writers of a persistent texture to run again on the next frame
+void renderGraphInvalidate(RenderGraph* p_graph, RenderGraphHandle handle);
+RenderTarget renderGraphTarget(const RenderGraph& graph, RenderGraphHandle handle);
+void renderGraphDeinit(RenderGraph* p_graph);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// Objects of the backend, 0 for none. The GL backend hands out the names GL
+// gives them, so the textures and framebuffers of RenderTarget can be passed
+// as they are.
+typedef uint32_t RendererTexture;
+typedef uint32_t RendererFramebuffer;
+typedef uint32_t RendererProgram;
+typedef uint32_t RendererBuffer;
+// the vertex and index buffers a draw reads, a vertex array for GL
+typedef uint32_t RendererGeometry;
+
+enum RendererTextureType {
+    RENDERER_TEXTURE_2D,
+    RENDERER_TEXTURE_2D_ARRAY,
+};
+
+// how a pipeline puts its output over the target
+enum RendererBlend {
+    RENDERER_BLEND_OPAQUE,
+    // straight alpha, what the GL backend leaves set between passes
+    RENDERER_BLEND_ALPHA,
+    // premultiplied output
+    RENDERER_BLEND_PREMULTIPLIED,
+    // straight alpha output kept premultiplied in the target, for layers
+    // put over others later
+    RENDERER_BLEND_PREMULTIPLY,
+    // straight alpha that keeps the alpha of the target
+    RENDERER_BLEND_KEEP_ALPHA,
+};
+
+// A program with the blending it draws with, everything a draw needs besides
+// its inputs, so a backend with explicit pipelines can bake them together
+struct RendererPipeline {
+    RendererProgram program;
+    RendererBlend blend;
+};
+
+// where the draws of a pass go, framebuffer 0 being the window
+struct RendererPass {
+    RendererFramebuffer framebuffer;
+    int32_t width;
+    int32_t height;
+    // what the target is cleared to first, if anything
+    std::optional<glm::vec4> clear;
+};
+
+// format of a storage image, as the shader declares it
+enum RendererFormat {
+    RENDERER_FORMAT_RGBA8,
+    RENDERER_FORMAT_RGBA16F,
+};
+
+// what the work after a dispatch reads of what it wrote
+enum RendererBarrier {
+    RENDERER_BARRIER_TEXTURE_FETCH,
+    // storage buffers and the indirect commands in them
+    RENDERER_BARRIER_STORAGE_AND_COMMANDS,
+};
+
+// The draws, dispatches and the state they need of the passes and the wet
+// glass steps, behind a table of functions. Draws only happen between
+// begin_pass and end_pass, dispatches outside of them.
+// Only a GL backend exists (RENDERER_OVERDRAW just wraps it) and the table does
+// not yet cover everything another backend would need: textures, targets and
+// buffers are still created and filled with GL by the modules owning them, the
+// blur pyramid draws into its levels with GL, and uniforms outside the Frame
+// block are set with glUniform* by the code using them.
+struct Renderer {
+    const char* name;
+    void (*begin_pass)(const RendererPass& pass);
+    void (*end_pass)();
+    void (*set_pipeline)(const RendererPipeline& pipeline);
+    void (*bind_texture)(uint32_t unit, RendererTexture texture, RendererTextureType type);
+    // binding of a std430 storage block
+    void (*bind_storage_buffer)(uint32_t binding, RendererBuffer buffer);
+    // level 0 of the texture, written by the dispatches
+    void (*bind_storage_image)(uint32_t unit, RendererTexture texture, RendererFormat format);
+    // triangles, instanced when instances is more than 1
+    void (*draw)(RendererGeometry geometry, uint32_t first, uint32_t count, uint32_t instances);
+    // triangles from the indices of the geometry
+    void (*draw_indexed)(RendererGeometry geometry, uint32_t first, uint32_t count);
+    // triangles as the DrawArraysIndirectCommand at offset in the buffer says
+    void (*draw_indirect)(RendererGeometry geometry, RendererBuffer commands, size_t offset);
+    void (*dispatch)(RendererProgram program, uint32_t groups_x, uint32_t groups_y);
+    void (*barrier)(RendererBarrier barrier);
+};
+
+// draws through gl_state.h
+extern const Renderer RENDERER_GL;
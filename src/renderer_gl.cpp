@@ -0,0 +1,124 @@
+#include "renderer.h"
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gl_state.h"
+
+void glRendererBeginPass(const RendererPass& pass);
+void glRendererEndPass();
+void glRendererSetPipeline(const RendererPipeline& pipeline);
+void glRendererBindTexture(uint32_t unit, RendererTexture texture, RendererTextureType type);
+void glRendererBindStorageBuffer(uint32_t binding, RendererBuffer buffer);
+void glRendererBindStorageImage(uint32_t unit, RendererTexture texture, RendererFormat format);
+void glRendererDraw(RendererGeometry geometry, uint32_t first, uint32_t count, uint32_t instances);
+void glRendererDrawIndexed(RendererGeometry geometry, uint32_t first, uint32_t count);
+void glRendererDrawIndirect(RendererGeometry geometry, RendererBuffer commands, size_t offset);
+void glRendererDispatch(RendererProgram program, uint32_t groups_x, uint32_t groups_y);
+void glRendererBarrier(RendererBarrier barrier);
+
+const Renderer RENDERER_GL = {
+    .name = "gl",
+    .begin_pass = glRendererBeginPass,
+    .end_pass = glRendererEndPass,
+    .set_pipeline = glRendererSetPipeline,
+    .bind_texture = glRendererBindTexture,
+    .bind_storage_buffer = glRendererBindStorageBuffer,
+    .bind_storage_image = glRendererBindStorageImage,
+    .draw = glRendererDraw,
+    .draw_indexed = glRendererDrawIndexed,
+    .draw_indirect = glRendererDrawIndirect,
+    .dispatch = glRendererDispatch,
+    .barrier = glRendererBarrier,
+};
+
+void glRendererBeginPass(const RendererPass& pass) {
+    glStateBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+    glStateViewport(0, 0, pass.width, pass.height);
+    if (pass.clear) {
+        const glm::vec4 color = pass.clear.value();
+        glClearColor(color.x, color.y, color.z, color.w);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+}
+
+// the code drawing without the renderer (the blur and the overdraw view)
+// expects the blending the passes started with
+void glRendererEndPass() {
+    glStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glStateBlend(true);
+}
+
+void glRendererSetPipeline(const RendererPipeline& pipeline) {
+    glStateUseProgram(pipeline.program);
+    switch (pipeline.blend) {
+        case RENDERER_BLEND_OPAQUE:
+            glStateBlend(false);
+            return;
+        case RENDERER_BLEND_ALPHA:
+            glStateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case RENDERER_BLEND_PREMULTIPLIED:
+            glStateBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case RENDERER_BLEND_PREMULTIPLY:
+            glStateBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case RENDERER_BLEND_KEEP_ALPHA:
+            glStateBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ZERO, GL_ONE);
+            break;
+    }
+    glStateBlend(true);
+}
+
+void glRendererBindTexture(uint32_t unit, RendererTexture texture, RendererTextureType type) {
+    glStateBindTexture(unit, texture, type == RENDERER_TEXTURE_2D_ARRAY ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D);
+}
+
+void glRendererBindStorageBuffer(uint32_t binding, RendererBuffer buffer) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+}
+
+void glRendererBindStorageImage(uint32_t unit, RendererTexture texture, RendererFormat format) {
+    const GLenum gl_format = format == RENDERER_FORMAT_RGBA16F ? GL_RGBA16F : GL_RGBA8;
+    glBindImageTexture(unit, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, gl_format);
+}
+
+void glRendererDraw(RendererGeometry geometry, uint32_t first, uint32_t count, uint32_t instances) {
+    glStateBindVertexArray(geometry);
+    if (instances > 1) {
+        glDrawArraysInstanced(GL_TRIANGLES, first, count, instances);
+    } else {
+        glDrawArrays(GL_TRIANGLES, first, count);
+    }
+}
+
+void glRendererDrawIndexed(RendererGeometry geometry, uint32_t first, uint32_t count) {
+    glStateBindVertexArray(geometry);
+    glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(first * sizeof(GLuint)));
+}
+
+void glRendererDrawIndirect(RendererGeometry geometry, RendererBuffer commands, size_t offset) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+    glStateBindVertexArray(geometry);
+    glDrawArraysIndirect(GL_TRIANGLES, (void*)offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void glRendererDispatch(RendererProgram program, uint32_t groups_x, uint32_t groups_y) {
+    glStateUseProgram(program);
+    glDispatchCompute(groups_x, groups_y, 1);
+}
+
+void glRendererBarrier(RendererBarrier barrier) {
+    switch (barrier) {
+        case RENDERER_BARRIER_TEXTURE_FETCH:
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            break;
+        case RENDERER_BARRIER_STORAGE_AND_COMMANDS:
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            break;
+    }
+}
@@ -4,16 +4,17 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <optional>
 #include <print>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <string>
 
-struct ShaderCodes {
-    const GLchar* vert;
-    const GLchar* frag;
-};
+#include "gl_state.h"
 
 void initRainArrays(
     RainVertex* vertices,
@@ -29,26 +30,87 @@ void initRainArrays(
 );
 std::optional<GLuint> textureInit(const std::string& filename, int32_t* p_width, int32_t* p_height);
 void textureDeinit(GLuint* p_texture);
-std::optional<RenderTarget> renderTargetInit(int32_t width, int32_t height);
-void renderTargetDeinit(RenderTarget* p_render_target);
 std::optional<Shaders> shadersInit();
-std::optional<GLuint> compileShader(const ShaderCodes shader_codes);
 void shadersDeinit(Shaders* p_shaders);
+std::optional<DropletPrograms> dropletProgramsInit(const std::string& defines);
+void dropletProgramsDeinit(DropletPrograms* p_programs);
 std::optional<Buffers> bufferInit(const float width, const float height, const RainVertex* rain_vertices, const GLuint* rain_indices);
 void initTextureVertexArray(const float width, const float height, const GLuint va, const GLuint vb, const GLuint eb);
 void initRainVertexArray(const GLuint va, const GLuint vb, const GLuint eb, const RainVertex* vertices, const GLuint* indices);
 void bufferDeinit(Buffers* p_buffer);
+bool reflectProgram(GLuint program);
+
+// the locations of the uniforms of every linked program, by program
+std::map<GLuint, std::array<GLint, UNIFORM_COUNT>> g_uniform_locations;
+
+// one triangle covering the target, drawn with glDrawArrays and no attributes
+const GLchar* FULLSCREEN_VERTEX_SHADER =
+    "#version 430 core\n"
+    ""
+    "layout (location = 0) out vec2 out_uv;"
+    ""
+    "void main() {"
+        "vec2 uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);"
+        "gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);"
+        "out_uv = uv;"
+    "}";
+
+// the image quad of the texture vertex array (elements 6 to 11) placed on the
+// window by the camera, cut down to the part of the image the offscreen
+// targets hold so their uv still run from 0 to 1
+const GLchar* SCREEN_VERTEX_SHADER =
+    "#version 430 core\n"
+    ""
+    "layout (location = 0) in vec2 in_pos;"
+    "layout (location = 1) in vec2 in_uv;"
+    ""
+    "layout (location = 0) out vec2 out_uv;"
+    ""
+    FRAME_UNIFORMS_GLSL
+    ""
+    "void main() {"
+        "vec2 pos = ((u_view.xy + in_uv*u_view.zw) * 2.0 - 1.0) * abs(in_pos);"
+        "gl_Position = vec4(u_scale*pos + u_cam_pos, 0.0, 1.0);"
+        "out_uv = in_uv;"
+    "}";
 
 std::optional<Resources> resourcesInit(Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen) {
     Resources resources = {};
+    resources.renderer = &RENDERER_GL;
 
     int32_t width = 0;
     int32_t height = 0;
-    auto texture = textureInit(config.picture, &width, &height);
-    if (!texture) {
+    int32_t channels = 0;
+    if (!stbi_info(config.picture.c_str(), &width, &height, &channels)) {
+        std::println("ERR: Failed to load image \"{}\": {}", config.picture, stbi_failure_reason());
         return std::nullopt;
     }
-    resources.texture = texture.value();
+
+    GLint max_texture_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    if (config.playlist.size() > 1) {
+        auto playlist = playlistInit(config.playlist, config.playlist_interval, max_texture_size);
+        if (!playlist) {
+            return std::nullopt;
+        }
+        width = playlist->width;
+        height = playlist->height;
+        resources.playlist = std::move(playlist.value());
+    } else if (config.virtual_texture || width > max_texture_size || height > max_texture_size) {
+        auto virtual_texture = virtualTextureInit(config.picture);
+        if (!virtual_texture) {
+            return std::nullopt;
+        }
+        resources.virtual_texture = virtual_texture.value();
+    } else {
+        auto texture = textureInit(config.picture, &width, &height);
+        if (!texture) {
+            return std::nullopt;
+        }
+        resources.texture = texture.value();
+    }
+    resources.texture_width = width;
+    resources.texture_height = height;
 
     GLuint rain_indices[RAIN_INDICES_COUNT] = {};
     initRainArrays(
@@ -57,7 +119,7 @@ std::optional<Resources> resourcesInit(Config config, std::uniform_real_distribu
         dis,
         gen,
         width, height,
-        0.01, 0.16,
+        RAIN_WIDTH, RAIN_HEIGHT,
         {config.color[0], config.color[1], config.color[2]},
         {config.color[3], config.color[4]}
     );
@@ -67,6 +129,9 @@ std::optional<Resources> resourcesInit(Config config, std::uniform_real_distribu
         return std::nullopt;
     }
     resources.shaders = shaders.value();
+    if (!resourcesUseDropletQuality(&resources, DROPLET_QUALITIES[config.quality], config.wet_glass)) {
+        return std::nullopt;
+    }
 
     auto buffers = bufferInit(width, height, resources.rain_vertices, rain_indices);
     if (!buffers) {
@@ -74,17 +139,38 @@ std::optional<Resources> resourcesInit(Config config, std::uniform_real_distribu
     }
     resources.buffers = buffers.value();
 
-    auto render_target = renderTargetInit(width, height);
-    if (!render_target) {
+    auto droplet_tiles = dropletTilesInit();
+    if (!droplet_tiles) {
         return std::nullopt;
     }
-    resources.render_target = render_target.value();
+    resources.droplet_tiles = droplet_tiles.value();
 
-    auto droplet_render_target = renderTargetInit(width, height);
-    if (!droplet_render_target) {
+    auto blur = blurInit();
+    if (!blur) {
         return std::nullopt;
     }
-    resources.droplet_render_target = droplet_render_target.value();
+    resources.blur = blur.value();
+
+    if (config.wet_glass) {
+        auto wet_glass = wetGlassInit(width, height);
+        if (!wet_glass) {
+            return std::nullopt;
+        }
+        resources.wet_glass = wet_glass.value();
+    }
+
+    if (config.physics_droplets > 0) {
+        auto droplet_sprites = dropletSpritesInit(config.physics_droplets);
+        if (!droplet_sprites) {
+            return std::nullopt;
+        }
+        resources.droplet_sprites = droplet_sprites.value();
+        auto droplet_physics = dropletPhysicsInit(config.physics_droplets, float(width) / float(height));
+        if (!droplet_physics) {
+            return std::nullopt;
+        }
+        resources.droplet_physics = std::move(droplet_physics.value());
+    }
 
     return resources;
 }
@@ -117,23 +203,37 @@ void initRainArrays(
 
 void resourcesDeinit(Resources* p_resources) {
     bufferDeinit(&p_resources->buffers);
+    dropletTilesDeinit(&p_resources->droplet_tiles);
+    blurDeinit(&p_resources->blur);
+    if (p_resources->wet_glass) {
+        wetGlassDeinit(&p_resources->wet_glass.value());
+        p_resources->wet_glass = std::nullopt;
+    }
+    if (p_resources->droplet_physics) {
+        dropletPhysicsDeinit(&p_resources->droplet_physics.value());
+        p_resources->droplet_physics = std::nullopt;
+    }
+    if (p_resources->droplet_sprites) {
+        dropletSpritesDeinit(&p_resources->droplet_sprites.value());
+        p_resources->droplet_sprites = std::nullopt;
+    }
     shadersDeinit(&p_resources->shaders);
+    for (auto& [defines, programs] : p_resources->droplet_programs) {
+        dropletProgramsDeinit(&programs);
+    }
+    p_resources->droplet_programs.clear();
     textureDeinit(&p_resources->texture);
-    renderTargetDeinit(&p_resources->render_target);
-    renderTargetDeinit(&p_resources->droplet_render_target);
+    if (p_resources->virtual_texture) {
+        virtualTextureDeinit(&p_resources->virtual_texture.value());
+        p_resources->virtual_texture = std::nullopt;
+    }
+    if (p_resources->playlist) {
+        playlistDeinit(&p_resources->playlist.value());
+        p_resources->playlist = std::nullopt;
+    }
 }
 
 std::optional<GLuint> textureInit(const std::string& filename, int32_t* p_width, int32_t* p_height) {
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
     stbi_set_flip_vertically_on_load(true);
     int32_t x, y, n;
     unsigned char *image = stbi_load(filename.c_str(), &x, &y, &n, 4);
@@ -141,9 +241,30 @@ std::optional<GLuint> textureInit(const std::string& filename, int32_t* p_width,
         std::println("ERR: Failed to load image \"{}\": {}", filename, stbi_failure_reason());
         return std::nullopt;
     }
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, x, y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLuint texture = 0;
+    const int32_t levels = renderTargetLevels(x, y);
+    if (dsaSupported()) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureStorage2D(texture, levels, GL_RGBA8, x, y);
+        glTextureSubImage2D(texture, 0, 0, 0, x, y, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        glGenerateTextureMipmap(texture);
+    } else {
+        glGenTextures(1, &texture);
+        glStateBindTexture(0, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, x, y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, x, y, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glStateBindTexture(0, 0);
+    }
     *p_width = x;
     *p_height = y;
 
@@ -152,31 +273,63 @@ std::optional<GLuint> textureInit(const std::string& filename, int32_t* p_width,
 }
 
 void textureDeinit(GLuint* p_texture) {
-    glDeleteTextures(1, p_texture);
+    glStateDeleteTextures(1, p_texture);
     *p_texture = 0;
 }
 
-std::optional<RenderTarget> renderTargetInit(int32_t width, int32_t height) {
-    GLuint render_framebuffer = 0;
-    glGenFramebuffers(1, &render_framebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, render_framebuffer);
+std::optional<RenderTargetFormat> renderTargetFormat(const std::string& name) {
+    for (const RenderTargetFormat& format : RENDER_TARGET_FORMATS) {
+        if (name == format.name) return format;
+    }
+    return std::nullopt;
+}
 
+std::optional<RenderTargetFormat> renderTargetFormat(GLenum format) {
+    for (const RenderTargetFormat& target_format : RENDER_TARGET_FORMATS) {
+        if (format == target_format.format) return target_format;
+    }
+    return std::nullopt;
+}
+
+int32_t renderTargetLevels(int32_t width, int32_t height) {
+    int32_t levels = 1;
+    while ((std::max(width, height) >> levels) > 0) levels += 1;
+    return levels;
+}
+
+std::optional<RenderTarget> renderTargetInit(int32_t width, int32_t height, GLenum format, int32_t levels) {
+    const GLenum min_filter = levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+    const GLenum draw_buffers[1] = { GL_COLOR_ATTACHMENT0 };
+    GLuint render_framebuffer = 0;
     GLuint render_texture = 0;
-    glGenTextures(1, &render_texture);
-    glBindTexture(GL_TEXTURE_2D, render_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, render_texture, 0);
-    GLenum draw_buffers[1] = { GL_COLOR_ATTACHMENT0 };
-    glDrawBuffers(1, draw_buffers);
-
-    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLenum status = GL_NONE;
+    if (dsaSupported()) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &render_texture);
+        glTextureStorage2D(render_texture, levels, format, width, height);
+        glTextureParameteri(render_texture, GL_TEXTURE_MIN_FILTER, min_filter);
+        glTextureParameteri(render_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glCreateFramebuffers(1, &render_framebuffer);
+        glNamedFramebufferTexture(render_framebuffer, GL_COLOR_ATTACHMENT0, render_texture, 0);
+        glNamedFramebufferDrawBuffers(render_framebuffer, 1, draw_buffers);
+        status = glCheckNamedFramebufferStatus(render_framebuffer, GL_FRAMEBUFFER);
+    } else {
+        glGenTextures(1, &render_texture);
+        glStateBindTexture(0, render_texture);
+        glTexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glGenFramebuffers(1, &render_framebuffer);
+        glStateBindFramebuffer(GL_FRAMEBUFFER, render_framebuffer);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, render_texture, 0);
+        glDrawBuffers(1, draw_buffers);
+        status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    }
     if(status != GL_FRAMEBUFFER_COMPLETE) {
         std::println("ERR: framebuffer creation failed ({})", status);
+        glStateDeleteFramebuffers(1, &render_framebuffer);
+        glStateDeleteTextures(1, &render_texture);
         return std::nullopt;
     }
 
@@ -185,17 +338,21 @@ std::optional<RenderTarget> renderTargetInit(int32_t width, int32_t height) {
         .texture = render_texture,
         .width = width,
         .height = height,
+        .format = format,
+        .levels = levels,
     };
 }
 
 void renderTargetDeinit(RenderTarget* p_render_target) {
-    glDeleteTextures(1, &p_render_target->texture);
-    glDeleteFramebuffers(1, &p_render_target->framebuffer);
+    glStateDeleteTextures(1, &p_render_target->texture);
+    glStateDeleteFramebuffers(1, &p_render_target->framebuffer);
 
     p_render_target->texture = 0;
     p_render_target->framebuffer = 0;
     p_render_target->width = 0;
     p_render_target->height = 0;
+    p_render_target->levels = 0;
+    p_render_target->format = GL_NONE;
 }
 
 std::string readShaderFile(const char* filePath) {
@@ -209,24 +366,15 @@ std::string readShaderFile(const char* filePath) {
     return buffer.str();
 }
 
-std::optional<Shaders> shadersInit() {
-    std::string droplet_vertex_shader_code = readShaderFile("src/dropletsVertex.h");
-    if (droplet_vertex_shader_code.empty()) {
-        std::println("ERR: Failed to read shader file");
-        return std::nullopt;
-    }
-
-    std::string droplet_fragment_shader_code = readShaderFile("src/droplets.h");
-    if (droplet_fragment_shader_code.empty()) {
-        std::println("ERR: Failed to read shader file");
-        return std::nullopt;
-    }
-
-    const ShaderCodes droplet_shader_codes = {
-        .vert = droplet_vertex_shader_code.c_str(),
-        .frag = droplet_fragment_shader_code.c_str(),
-    };
+// inserts the common code right after the #version line of a shader
+std::string withCommonCode(const std::string& code, const std::string& common_code) {
+    size_t line_end = code.find('\n');
+    if (line_end == std::string::npos) return code;
+    return code.substr(0, line_end + 1) + common_code + code.substr(line_end + 1);
+}
 
+std::optional<Shaders> shadersInit() {
+    // fills the target with the part of the image it holds
     const ShaderCodes texture_shader_codes = {
         .vert =
         "#version 430 core\n"
@@ -236,9 +384,11 @@ std::optional<Shaders> shadersInit() {
         ""
         "layout (location = 0) out vec2 out_uv;"
         ""
+        FRAME_UNIFORMS_GLSL
+        ""
         "void main() {"
             "gl_Position = vec4(in_pos, 0.0, 1.0);"
-            "out_uv = in_uv;"
+            "out_uv = u_view.xy + in_uv*u_view.zw;"
         "}",
         .frag =
         "#version 430 core\n"
@@ -253,6 +403,12 @@ std::optional<Shaders> shadersInit() {
             "frag_color = texture(sampler, in_uv);"
         "}",
     };
+    // A streak is only a pixel or two wide, so instead of multisampling the
+    // quads are widened by a pixel on both sides and the fragment shader
+    // computes how much of every pixel the streak covers across its width,
+    // from the screen-space derivative of the position across it. The streaks
+    // move in clip space of the whole image, which is mapped onto the part of
+    // it the target holds.
     const ShaderCodes rain_shader_codes = {
         .vert =
         "#version 430 core\n"
@@ -261,38 +417,123 @@ std::optional<Shaders> shadersInit() {
         "layout (location = 1) in vec4 in_color;"
         ""
         "layout (location = 0) out vec4 out_color;"
+        "layout (location = 1) out float out_across;"
+        ""
+        FRAME_UNIFORMS_GLSL
         ""
         "void main() {"
-            "gl_Position = vec4(in_pos, 0.0, 1.0);"
+            // the first two vertices of a quad are on its right edge
+            "float side = gl_VertexID % 4 < 2 ? 1.0 : -1.0;"
+            "float pixel = u_rain_antialiased != 0u ? 2.0 / float(u_resolution.x) : 0.0;"
+            "vec2 pos = ((in_pos * 0.5 + 0.5 - u_view.xy) / u_view.zw) * 2.0 - 1.0;"
+            "gl_Position = vec4(pos.x + side * pixel, pos.y, 0.0, 1.0);"
+            // in half widths from the middle of the streak
+            "float half_width = u_rain_half_width / u_view.z;"
+            "out_across = side * (half_width + pixel) / half_width;"
             "out_color = in_color;"
         "}",
         .frag =
         "#version 430 core\n"
         ""
         "layout (location = 0) in vec4 in_color;"
+        "layout (location = 1) in float in_across;"
         ""
         "layout (location = 0) out vec4 frag_color;"
         ""
+        FRAME_UNIFORMS_GLSL
+        ""
         "void main() {"
-            "frag_color = in_color;"
+            "float coverage = 1.0;"
+            "if (u_rain_antialiased != 0u) {"
+                // overlap of the pixel with the streak, in pixels
+                "float half_width = 1.0 / fwidth(in_across);"
+                "float x = abs(in_across) * half_width;"
+                "coverage = clamp(min(x + 0.5, half_width) - max(x - 0.5, -half_width), 0.0, 1.0);"
+            "}"
+            "frag_color = vec4(in_color.rgb, in_color.a * coverage);"
         "}",
     };
     const ShaderCodes screen_shader_codes = {
-        .vert =
+        .vert = SCREEN_VERTEX_SHADER,
+        .frag =
         "#version 430 core\n"
         ""
-        "layout (location = 0) in vec2 in_pos;"
-        "layout (location = 1) in vec2 in_uv;"
+        "layout (location = 0) in vec2 in_uv;"
         ""
-        "layout (location = 0) out vec2 out_uv;"
+        "layout (location = 0) out vec4 frag_color;"
         ""
-        "layout (location = 0) uniform vec2 scale;"
-        "layout (location = 1) uniform vec2 cam_pos;"
+        "uniform sampler2D sampler;"
         ""
         "void main() {"
-            "gl_Position = vec4(scale*in_pos + cam_pos, 0.0, 1.0);"
-            "out_uv = in_uv;"
+            "frag_color = texture(sampler, in_uv);"
         "}",
+    };
+
+    // looks up every texel through the indirection table, falling back to
+    // coarser levels while the tiles of the wanted one are streamed in. The
+    // cache has no mipmaps of its own, the levels are the mipmaps: a pixel
+    // covering more than a texel of the streamed level blends it with the
+    // next coarser one, like trilinear filtering, rather than aliasing.
+    const std::string virtual_texture_fragment_shader_code =
+        "#version 430 core\n"
+        "#define TILE_SIZE " + std::to_string(VT_TILE_SIZE) + "\n"
+        "#define TILE_BORDER " + std::to_string(VT_TILE_BORDER) + "\n"
+        "#define TILE_PAYLOAD " + std::to_string(VT_TILE_PAYLOAD) + "\n"
+        "#define CACHE_TILES " + std::to_string(VT_CACHE_TILES) + "\n"
+        "#define MAX_LEVELS " + std::to_string(VT_MAX_LEVELS) + "\n"
+        ""
+        "layout (location = 0) in vec2 in_uv;"
+        ""
+        "layout (location = 0) out vec4 frag_color;"
+        ""
+        "uniform sampler2D u_cache;"
+        "uniform usampler2D u_indirection;"
+        "uniform int u_level;"
+        "uniform int u_level_count;"
+        "uniform ivec2 u_level_offset[MAX_LEVELS];"
+        "uniform ivec2 u_level_tiles[MAX_LEVELS];"
+        "uniform vec2 u_level_size[MAX_LEVELS];"
+        ""
+        // false while the tile of the level is not in the cache
+        "bool sampleLevel(int level, out vec4 color) {"
+            "vec2 texel = in_uv * u_level_size[level];"
+            "ivec2 tile = min(ivec2(texel / float(TILE_PAYLOAD)), u_level_tiles[level] - 1);"
+            "uvec4 entry = texelFetch(u_indirection, u_level_offset[level] + tile, 0);"
+            "if (entry.b == 0u) return false;"
+            ""
+            "vec2 in_tile = texel - vec2(tile * TILE_PAYLOAD) + float(TILE_BORDER);"
+            "vec2 cache_uv = (vec2(entry.rg) * float(TILE_SIZE) + in_tile) / float(CACHE_TILES * TILE_SIZE);"
+            "color = textureLod(u_cache, cache_uv, 0.0);"
+            "return true;"
+        "}"
+        ""
+        "void main() {"
+            // texels of the finest level across a pixel, as a level, never
+            // finer than the one streamed in
+            "vec2 texel = in_uv * u_level_size[0];"
+            "float footprint = max(length(dFdx(texel)), length(dFdy(texel)));"
+            "float lod = clamp(log2(max(footprint, 1.0)), float(u_level), float(u_level_count - 1));"
+            "int first = int(lod);"
+            "for (int level = first; level < u_level_count; level++) {"
+                "vec4 color;"
+                "if (!sampleLevel(level, color)) continue;"
+                ""
+                "vec4 coarser;"
+                "if (level == first && level + 1 < u_level_count && sampleLevel(level + 1, coarser)) {"
+                    "color = mix(color, coarser, lod - float(first));"
+                "}"
+                "frag_color = color;"
+                "return;"
+            "}"
+            "frag_color = vec4(0.0);"
+        "}";
+    const ShaderCodes virtual_texture_shader_codes = {
+        .vert = texture_shader_codes.vert,
+        .frag = virtual_texture_fragment_shader_code.c_str(),
+    };
+    // crossfades from the image shown to the next one
+    const ShaderCodes playlist_shader_codes = {
+        .vert = texture_shader_codes.vert,
         .frag =
         "#version 430 core\n"
         ""
@@ -300,16 +541,17 @@ std::optional<Shaders> shadersInit() {
         ""
         "layout (location = 0) out vec4 frag_color;"
         ""
-        "uniform sampler2D sampler;"
+        "uniform sampler2DArray u_backgrounds;"
+        "uniform ivec2 u_layers;"
+        "uniform float u_fade;"
         ""
         "void main() {"
-            "frag_color = texture(sampler, in_uv);"
+            "vec4 shown = texture(u_backgrounds, vec3(in_uv, float(u_layers.x)));"
+            "vec4 next = texture(u_backgrounds, vec3(in_uv, float(u_layers.y)));"
+            "frag_color = mix(shown, next, u_fade);"
         "}",
     };
 
-    auto droplet_program = compileShader(droplet_shader_codes);
-    if (!droplet_program) return std::nullopt;
-
     auto texture_program = compileShader(texture_shader_codes);
     if (!texture_program) return std::nullopt;
 
@@ -317,13 +559,21 @@ std::optional<Shaders> shadersInit() {
     if (!rain_program) return std::nullopt;
 
     auto screen_program = compileShader(screen_shader_codes);
-    if (!rain_program) return std::nullopt;
+    if (!screen_program) return std::nullopt;
+
+    auto virtual_texture_program = compileShader(virtual_texture_shader_codes);
+    if (!virtual_texture_program) return std::nullopt;
+
+    auto playlist_program = compileShader(playlist_shader_codes);
+    if (!playlist_program) return std::nullopt;
 
     return Shaders{
         .texture = texture_program.value(),
         .rain = rain_program.value(),
         .screen = screen_program.value(),
-        .droplet = droplet_program.value(),
+        .droplet = {},
+        .virtual_texture = virtual_texture_program.value(),
+        .playlist = playlist_program.value(),
     };
 }
 
@@ -365,15 +615,235 @@ std::optional<GLuint> compileShader(const ShaderCodes shader_codes) {
         std::println("ERR: Shader program linking failed: {}", info);
         return std::nullopt;
     }
+    if (!reflectProgram(program)) {
+        glDeleteProgram(program);
+        return std::nullopt;
+    }
+
+    return program;
+}
+
+std::optional<GLuint> compileComputeShader(const GLchar* code) {
+    GLint success;
+    GLchar info[512];
+
+    GLuint compute_shader = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute_shader, 1, &code, NULL);
+    glCompileShader(compute_shader);
+    glGetShaderiv(compute_shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(compute_shader, 512, NULL, info);
+        std::println("ERR: Shader compute compilation failed: {}", info);
+        glDeleteShader(compute_shader);
+        return std::nullopt;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, compute_shader);
+    glLinkProgram(program);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    glDeleteShader(compute_shader);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, info);
+        std::println("ERR: Shader program linking failed: {}", info);
+        return std::nullopt;
+    }
+    if (!reflectProgram(program)) {
+        glDeleteProgram(program);
+        return std::nullopt;
+    }
 
     return program;
 }
 
+// Goes through the uniforms and blocks of a freshly linked program: samplers
+// are bound to their unit from SAMPLER_UNITS, the locations of the other
+// uniforms in UNIFORM_NAMES are kept for uniformLocation, and a Frame block
+// has to match FrameUniforms, so a mismatch fails at startup instead of
+// drawing garbage.
+bool reflectProgram(GLuint program) {
+    GLchar name[256];
+
+    std::array<GLint, UNIFORM_COUNT> locations;
+    locations.fill(-1);
+    GLint uniform_count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+    for (GLint i = 0; i < uniform_count; i++) {
+        const GLenum props[3] = { GL_TYPE, GL_LOCATION, GL_BLOCK_INDEX };
+        GLint values[3] = {};
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 3, props, 3, NULL, values);
+        glGetProgramResourceName(program, GL_UNIFORM, i, sizeof(name), NULL, name);
+
+        const GLint type = values[0];
+        const GLint location = values[1];
+        const GLint block = values[2];
+        const bool sampler = type == GL_SAMPLER_2D || type == GL_UNSIGNED_INT_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY;
+        if (block != -1) continue;
+        if (!sampler) {
+            // arrays are named after their first element
+            char* bracket = strchr(name, '[');
+            if (bracket != NULL) *bracket = '\0';
+            for (int32_t u = 0; u < UNIFORM_COUNT; u++) {
+                if (strcmp(UNIFORM_NAMES[u], name) == 0) locations[u] = location;
+            }
+            continue;
+        }
+
+        const SamplerUnit* unit = NULL;
+        for (const SamplerUnit& candidate : SAMPLER_UNITS) {
+            if (strcmp(candidate.name, name) == 0) unit = &candidate;
+        }
+        if (unit == NULL) {
+            std::println("ERR: sampler \"{}\" has no texture unit", name);
+            return false;
+        }
+        // without making the program current
+        glProgramUniform1i(program, location, unit->unit);
+    }
+
+    GLint block_count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &block_count);
+    for (GLint i = 0; i < block_count; i++) {
+        const GLenum props[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        GLint values[2] = {};
+        glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, i, 2, props, 2, NULL, values);
+        glGetProgramResourceName(program, GL_UNIFORM_BLOCK, i, sizeof(name), NULL, name);
+
+        if (strcmp(name, "Frame") != 0) {
+            std::println("ERR: unknown uniform block \"{}\"", name);
+            return false;
+        }
+        if (values[0] != FRAME_UNIFORMS_BINDING || values[1] != GLint(sizeof(FrameUniforms))) {
+            std::println("ERR: uniform block \"Frame\" is {} bytes at binding {}, expected {} bytes at binding {}",
+                values[1], values[0], sizeof(FrameUniforms), FRAME_UNIFORMS_BINDING);
+            return false;
+        }
+    }
+
+    // a program name can be reused once deleted, which overwrites its entry
+    g_uniform_locations[program] = locations;
+    return true;
+}
+
+GLint uniformLocation(GLuint program, Uniform uniform) {
+    auto locations = g_uniform_locations.find(program);
+    if (locations == g_uniform_locations.end()) return -1;
+    return locations->second[uniform];
+}
+
+std::string dropletQualityDefines(const DropletQuality& quality, bool wet_glass) {
+    return
+        "#define DROPLET_TILE_SIZE " + std::to_string(DROPLET_TILE_SIZE) + "\n"
+        "#define DROPLET_LAYERS " + std::to_string(quality.layers) + "\n"
+        "#define DROPLET_GRID vec2(" + std::to_string(quality.grid_x) + ", " + std::to_string(quality.grid_y) + ")\n"
+        "#define DROPLET_BLUR " + std::to_string(int(quality.blur)) + "\n"
+        "#define DROPLET_WET_GLASS " + std::to_string(int(wet_glass)) + "\n";
+}
+
+// compiles every droplet program with the #defines of one permutation
+std::optional<DropletPrograms> dropletProgramsInit(const std::string& defines) {
+    std::string droplet_common_code = readShaderFile("src/dropletsCommon.h");
+    if (droplet_common_code.empty()) {
+        std::println("ERR: Failed to read shader file");
+        return std::nullopt;
+    }
+    const std::string prelude = defines + FRAME_UNIFORMS_GLSL "\n";
+    const std::string common_code = prelude + droplet_common_code;
+
+    // the full resolution droplet shaders are drawn per tile
+    std::string droplet_tile_vertex_shader_code = withCommonCode(readShaderFile("src/dropletsTileVertex.h"), prelude);
+    std::string droplet_classify_shader_code = withCommonCode(readShaderFile("src/dropletsClassify.h"), common_code);
+    std::string droplet_dry_fragment_shader_code = withCommonCode(readShaderFile("src/dropletsDry.h"), common_code);
+    std::string droplet_fragment_shader_code = withCommonCode(readShaderFile("src/droplets.h"), common_code);
+    std::string droplet_field_shader_code = withCommonCode(readShaderFile("src/dropletsField.h"), common_code);
+    std::string droplet_composite_fragment_shader_code = withCommonCode(readShaderFile("src/dropletsComposite.h"), common_code);
+    std::string droplet_wet_glass_shader_code = withCommonCode(readShaderFile("src/dropletsWetGlass.h"), prelude);
+    std::string droplet_sprite_vertex_shader_code = withCommonCode(readShaderFile("src/dropletsSpriteVertex.h"), prelude);
+    std::string droplet_sprite_fragment_shader_code = withCommonCode(readShaderFile("src/dropletsSprite.h"), common_code);
+
+    const ShaderCodes droplet_shader_codes = {
+        .vert = droplet_tile_vertex_shader_code.c_str(),
+        .frag = droplet_fragment_shader_code.c_str(),
+    };
+    const ShaderCodes droplet_dry_shader_codes = {
+        .vert = droplet_tile_vertex_shader_code.c_str(),
+        .frag = droplet_dry_fragment_shader_code.c_str(),
+    };
+    const ShaderCodes droplet_composite_shader_codes = {
+        .vert = droplet_tile_vertex_shader_code.c_str(),
+        .frag = droplet_composite_fragment_shader_code.c_str(),
+    };
+    const ShaderCodes droplet_sprite_shader_codes = {
+        .vert = droplet_sprite_vertex_shader_code.c_str(),
+        .frag = droplet_sprite_fragment_shader_code.c_str(),
+    };
+
+    // the programs compiled before one that fails are deleted with the rest
+    const std::optional<GLuint> compiled[] = {
+        compileShader(droplet_shader_codes),
+        compileComputeShader(droplet_field_shader_code.c_str()),
+        compileShader(droplet_composite_shader_codes),
+        compileComputeShader(droplet_classify_shader_code.c_str()),
+        compileShader(droplet_dry_shader_codes),
+        compileComputeShader(droplet_wet_glass_shader_code.c_str()),
+        compileShader(droplet_sprite_shader_codes),
+    };
+    DropletPrograms programs = {
+        .shade = compiled[0].value_or(0),
+        .field = compiled[1].value_or(0),
+        .composite = compiled[2].value_or(0),
+        .classify = compiled[3].value_or(0),
+        .dry = compiled[4].value_or(0),
+        .wet_glass = compiled[5].value_or(0),
+        .sprite = compiled[6].value_or(0),
+    };
+    for (const std::optional<GLuint>& program : compiled) {
+        if (!program) {
+            dropletProgramsDeinit(&programs);
+            return std::nullopt;
+        }
+    }
+
+    return programs;
+}
+
+void dropletProgramsDeinit(DropletPrograms* p_programs) {
+    glDeleteProgram(p_programs->shade);
+    glDeleteProgram(p_programs->field);
+    glDeleteProgram(p_programs->composite);
+    glDeleteProgram(p_programs->classify);
+    glDeleteProgram(p_programs->dry);
+    glDeleteProgram(p_programs->wet_glass);
+    glDeleteProgram(p_programs->sprite);
+    *p_programs = {};
+}
+
+bool resourcesUseDropletQuality(Resources* p_resources, const DropletQuality& quality, bool wet_glass) {
+    const std::string defines = dropletQualityDefines(quality, wet_glass);
+    auto cached = p_resources->droplet_programs.find(defines);
+    if (cached == p_resources->droplet_programs.end()) {
+        auto programs = dropletProgramsInit(defines);
+        if (!programs) return false;
+        std::println("INFO: compiled the droplet programs for quality \"{}\"", quality.name);
+        cached = p_resources->droplet_programs.emplace(defines, programs.value()).first;
+    }
+    p_resources->shaders.droplet = cached->second;
+    return true;
+}
+
 void shadersDeinit(Shaders* p_shaders) {
     glDeleteProgram(p_shaders->texture);
     glDeleteProgram(p_shaders->rain);
+    glDeleteProgram(p_shaders->screen);
+    glDeleteProgram(p_shaders->virtual_texture);
+    glDeleteProgram(p_shaders->playlist);
     p_shaders->texture = 0;
     p_shaders->rain = 0;
+    p_shaders->screen = 0;
+    p_shaders->droplet = {};
+    p_shaders->virtual_texture = 0;
+    p_shaders->playlist = 0;
 }
 
 // currently no error checking
@@ -381,9 +851,23 @@ std::optional<Buffers> bufferInit(const float width, const float height, const R
     GLuint VAs[2] = { 0, 0 };
     GLuint VBs[2] = { 0, 0 };
     GLuint EBs[2] = { 0, 0 };
-    glGenVertexArrays(2, VAs);
-    glGenBuffers(2, VBs);
-    glGenBuffers(2, EBs);
+    GLuint frame_uniform_buf = 0;
+    // without DSA the names only become objects when first bound
+    if (dsaSupported()) {
+        glCreateVertexArrays(2, VAs);
+        glCreateBuffers(2, VBs);
+        glCreateBuffers(2, EBs);
+        glCreateBuffers(1, &frame_uniform_buf);
+        glNamedBufferStorage(frame_uniform_buf, sizeof(FrameUniforms), NULL, GL_DYNAMIC_STORAGE_BIT);
+    } else {
+        glGenVertexArrays(2, VAs);
+        glGenBuffers(2, VBs);
+        glGenBuffers(2, EBs);
+        glGenBuffers(1, &frame_uniform_buf);
+        glBindBuffer(GL_UNIFORM_BUFFER, frame_uniform_buf);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
 
     initTextureVertexArray(width, height, VAs[0], VBs[0], EBs[0]);
     initRainVertexArray(VAs[1], VBs[1], EBs[1], rain_vertices, rain_indices);
@@ -395,6 +879,7 @@ std::optional<Buffers> bufferInit(const float width, const float height, const R
         .rain_vert_arr = VAs[1],
         .rain_vert_buf = VBs[1],
         .rain_elem_buf = EBs[1],
+        .frame_uniform_buf = frame_uniform_buf,
     };
 }
 
@@ -420,7 +905,22 @@ void initTextureVertexArray(const float width, const float height, const GLuint
         5, 6, 7,
     };
 
-    glBindVertexArray(va);
+    if (dsaSupported()) {
+        glNamedBufferStorage(vb, sizeof(vertices), vertices, 0);
+        glNamedBufferStorage(eb, sizeof(indices), indices, 0);
+
+        glVertexArrayVertexBuffer(va, 0, vb, 0, sizeof(TextureVertex));
+        glVertexArrayElementBuffer(va, eb);
+        glVertexArrayAttribFormat(va, 0, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribFormat(va, 1, 2, GL_FLOAT, GL_FALSE, offsetof(TextureVertex, uv));
+        glVertexArrayAttribBinding(va, 0, 0);
+        glVertexArrayAttribBinding(va, 1, 0);
+        glEnableVertexArrayAttrib(va, 0);
+        glEnableVertexArrayAttrib(va, 1);
+        return;
+    }
+
+    glStateBindVertexArray(va);
 
     glBindBuffer(GL_ARRAY_BUFFER, vb);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
@@ -433,13 +933,29 @@ void initTextureVertexArray(const float width, const float height, const GLuint
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    glStateBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+// the vertices are rewritten every frame
 void initRainVertexArray(const GLuint va, const GLuint vb, const GLuint eb, const RainVertex* vertices, const GLuint* indices) {
-    glBindVertexArray(va);
+    if (dsaSupported()) {
+        glNamedBufferStorage(vb, RAIN_VERTICES_COUNT*sizeof(RainVertex), vertices, GL_DYNAMIC_STORAGE_BIT);
+        glNamedBufferStorage(eb, RAIN_INDICES_COUNT*sizeof(GLuint), indices, 0);
+
+        glVertexArrayVertexBuffer(va, 0, vb, 0, sizeof(RainVertex));
+        glVertexArrayElementBuffer(va, eb);
+        glVertexArrayAttribFormat(va, 0, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribFormat(va, 1, 4, GL_FLOAT, GL_FALSE, offsetof(RainVertex, clr));
+        glVertexArrayAttribBinding(va, 0, 0);
+        glVertexArrayAttribBinding(va, 1, 0);
+        glEnableVertexArrayAttrib(va, 0);
+        glEnableVertexArrayAttrib(va, 1);
+        return;
+    }
+
+    glStateBindVertexArray(va);
 
     glBindBuffer(GL_ARRAY_BUFFER, vb);
     glBufferData(GL_ARRAY_BUFFER, RAIN_VERTICES_COUNT*sizeof(RainVertex), vertices, GL_DYNAMIC_DRAW);
@@ -452,7 +968,7 @@ void initRainVertexArray(const GLuint va, const GLuint vb, const GLuint eb, cons
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    glStateBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
@@ -461,9 +977,10 @@ void bufferDeinit(Buffers* p_buffer) {
     GLuint VAs[2] = {p_buffer->vert_arr, p_buffer->rain_vert_arr};
     GLuint VBs[2] = {p_buffer->vert_buf, p_buffer->rain_vert_buf};
     GLuint EBs[2] = {p_buffer->elem_buf, p_buffer->rain_elem_buf};
-    glDeleteVertexArrays(2, VAs);
+    glStateDeleteVertexArrays(2, VAs);
     glDeleteBuffers(2, VBs);
     glDeleteBuffers(2, EBs);
+    glDeleteBuffers(1, &p_buffer->frame_uniform_buf);
 
     p_buffer->vert_arr = 0;
     p_buffer->vert_buf = 0;
@@ -471,4 +988,30 @@ void bufferDeinit(Buffers* p_buffer) {
     p_buffer->rain_vert_arr = 0;
     p_buffer->rain_vert_buf = 0;
     p_buffer->rain_elem_buf = 0;
+    p_buffer->frame_uniform_buf = 0;
+}
+
+bool dsaSupported() {
+    return GLAD_GL_VERSION_4_5 || GLAD_GL_ARB_direct_state_access;
+}
+
+void frameUniformsUpload(const Buffers& buffers, const FrameUniforms& uniforms) {
+    if (dsaSupported()) {
+        glNamedBufferSubData(buffers.frame_uniform_buf, 0, sizeof(FrameUniforms), &uniforms);
+    } else {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffers.frame_uniform_buf);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &uniforms);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, buffers.frame_uniform_buf);
+}
+
+void rainVerticesUpload(const Buffers& buffers, const RainVertex* vertices, uint32_t count) {
+    if (dsaSupported()) {
+        glNamedBufferSubData(buffers.rain_vert_buf, 0, count*sizeof(RainVertex), vertices);
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers.rain_vert_buf);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count*sizeof(RainVertex), vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 }
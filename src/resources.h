@@ -1,20 +1,88 @@
+#pragma once
+
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 
+#include "blur.h"
+#include "droplet_physics.h"
+#include "droplet_sprites.h"
+#include "droplet_tiles.h"
+#include "playlist.h"
+#include "renderer.h"
+#include "wet_glass.h"
+#include "virtual_texture.h"
+
+#include <map>
 #include <optional>
 #include <random>
 #include <string>
+#include <vector>
 
 #define RAIN_PARTICLES_COUNT 8192
 #define RAIN_VERTICES_COUNT 4 * RAIN_PARTICLES_COUNT
 #define RAIN_INDICES_COUNT 6 * RAIN_PARTICLES_COUNT
+// size of a rain streak in units of the image height
+#define RAIN_WIDTH 0.01
+#define RAIN_HEIGHT 0.16
+
+struct TargetFormats {
+    GLenum background;
+    GLenum rain;
+    GLenum droplet;
+};
+
+// Blur radius seen through a droplet, in uv of the image so it looks the same
+// at any size and zoom
+#define DROPLET_BLUR_RADIUS 0.005f
+
+// A permutation of the droplet shaders, the parameters are compiled in as
+// #defines so every level is unrolled and stripped for what it uses
+struct DropletQuality {
+    const char* name;
+    int32_t layers;
+    // droplet cells per unit of uv
+    float grid_x;
+    float grid_y;
+    // blur behind the droplets, needs the blur pyramids
+    bool blur;
+};
+
+const DropletQuality DROPLET_QUALITIES[] = {
+    { .name = "low", .layers = 1, .grid_x = 9.0, .grid_y = 4.5, .blur = false },
+    { .name = "medium", .layers = 2, .grid_x = 9.0, .grid_y = 4.5, .blur = true },
+    { .name = "high", .layers = 3, .grid_x = 12.0, .grid_y = 6.0, .blur = true },
+};
 
 struct Config {
     std::string picture;
+    // every picture given when there is more than one, shown in turn
+    std::vector<std::string> playlist;
+    float playlist_interval;
     uint32_t rain_count;
     float speed;
     glm::vec3 rgb;
     float color[5]; // R G B A_top A_bot
+    bool droplets;
+    // the droplets are evaluated at 1/droplet_divisor of the render size
+    int32_t droplet_divisor;
+    // index into DROPLET_QUALITIES
+    size_t quality;
+    float target_fps;
+    bool virtual_texture;
+    TargetFormats formats;
+    // indices into POST_EFFECTS, in the order they are applied
+    std::vector<size_t> post_effects;
+    // the droplet pass draws straight onto the window when nothing else
+    // reads its output
+    bool direct;
+    bool rain_antialiased;
+    // the droplets come from the wet glass simulation
+    bool wet_glass;
+    // most droplets of the CPU simulation drawn over the others, 0 for none
+    size_t physics_droplets;
+    // the CPU droplets are the only ones, drawn over dry glass
+    bool sprites_only;
+    bool benchmark;
 };
 
 struct TextureVertex {
@@ -68,11 +136,131 @@ struct RainQuad {
     }
 };
 
+struct ShaderCodes {
+    const GLchar* vert;
+    const GLchar* frag;
+};
+
+extern const GLchar* FULLSCREEN_VERTEX_SHADER;
+extern const GLchar* SCREEN_VERTEX_SHADER;
+
+#define FRAME_UNIFORMS_BINDING 0
+
+// Constants of the whole frame, uploaded once per frame into one std140
+// uniform buffer that every program reads through the Frame block
+struct FrameUniforms {
+    // window transform of the screen shader
+    glm::vec2 scale;
+    glm::vec2 cam_pos;
+    // size of the offscreen targets
+    glm::ivec2 resolution;
+    float time;
+    // pixels the droplets may spread beyond where they are evaluated
+    float droplet_margin;
+    // rgb, and how much of it is mixed in
+    glm::vec4 tint;
+    // wet and dry slots of the droplet tile lists
+    uint32_t tile_count;
+    // the droplet tiles are drawn onto the window with the window transform
+    // instead of filling the offscreen target
+    uint32_t droplet_to_window;
+    // half the width of a rain streak, in clip space
+    float rain_half_width;
+    // the rain shader computes the coverage of the streak edges itself
+    uint32_t rain_antialiased;
+    // the part of the image the offscreen targets hold, its corner in xy and
+    // its size in zw, in uv of the image
+    glm::vec4 view;
+};
+static_assert(sizeof(FrameUniforms) == 80, "FrameUniforms must match the std140 Frame block");
+
+// GLSL declaration of FrameUniforms, binding FRAME_UNIFORMS_BINDING
+#define FRAME_UNIFORMS_GLSL \
+    "layout (std140, binding = 0) uniform Frame {" \
+        "vec2 u_scale;" \
+        "vec2 u_cam_pos;" \
+        "ivec2 u_resolution;" \
+        "float u_time;" \
+        "float u_droplet_margin;" \
+        "vec4 u_tint;" \
+        "uint u_tile_count;" \
+        "uint u_droplet_to_window;" \
+        "float u_rain_half_width;" \
+        "uint u_rain_antialiased;" \
+        "vec4 u_view;" \
+    "};"
+
+// texture unit of every sampler uniform, bound once when a program is linked
+struct SamplerUnit {
+    const char* name;
+    GLint unit;
+};
+
+const SamplerUnit SAMPLER_UNITS[] = {
+    { .name = "sampler", .unit = 0 },
+    { .name = "u_texture", .unit = 0 },
+    { .name = "u_rain", .unit = 1 },
+    { .name = "u_field", .unit = 2 },
+    { .name = "u_background_blur", .unit = 3 },
+    { .name = "u_rain_blur", .unit = 4 },
+    { .name = "u_backgrounds", .unit = 0 },
+    { .name = "u_cache", .unit = 0 },
+    { .name = "u_indirection", .unit = 1 },
+    { .name = "u_source", .unit = 0 },
+    { .name = "u_counter", .unit = 0 },
+    { .name = "u_total", .unit = 0 },
+    { .name = "u_wet_glass", .unit = WET_GLASS_UNIT },
+    { .name = "u_droplet_atlas", .unit = DROPLET_ATLAS_UNIT },
+};
+
+// the uniforms outside the Frame block that are set while drawing, whose
+// locations are looked up once when a program is linked
+enum Uniform {
+    UNIFORM_LEVEL,
+    UNIFORM_LEVEL_COUNT,
+    UNIFORM_LEVEL_OFFSET,
+    UNIFORM_LEVEL_TILES,
+    UNIFORM_LEVEL_SIZE,
+    UNIFORM_LAYERS,
+    UNIFORM_FADE,
+    UNIFORM_STEP,
+    UNIFORM_COUNT,
+};
+
+const char* const UNIFORM_NAMES[UNIFORM_COUNT] = {
+    "u_level",
+    "u_level_count",
+    "u_level_offset",
+    "u_level_tiles",
+    "u_level_size",
+    "u_layers",
+    "u_fade",
+    "u_step",
+};
+
+struct DropletPrograms {
+    // evaluates the droplets for every pixel
+    GLuint shade;
+    // the droplets at a fraction of the resolution, and their full resolution composite
+    GLuint field;
+    GLuint composite;
+    // sorts the tiles of the droplet pass, and shades the ones without droplets
+    GLuint classify;
+    GLuint dry;
+    // one step of the wet glass simulation
+    GLuint wet_glass;
+    // the droplets of the CPU simulation
+    GLuint sprite;
+};
+
 struct Shaders {
     GLuint texture;
     GLuint rain;
     GLuint screen;
-    GLuint droplet;
+    // of the quality in use, owned by Resources::droplet_programs
+    DropletPrograms droplet;
+    GLuint virtual_texture;
+    GLuint playlist;
 };
 
 struct Buffers {
@@ -82,6 +270,26 @@ struct Buffers {
     GLuint rain_vert_arr;
     GLuint rain_vert_buf;
     GLuint rain_elem_buf;
+    // FrameUniforms
+    GLuint frame_uniform_buf;
+};
+
+struct RenderTargetFormat {
+    const char* name;
+    GLenum format;
+    uint32_t bytes_per_pixel;
+    bool alpha;
+};
+
+// colour formats the offscreen targets can use, RGB565 is for low-end GPUs and
+// RGBA16F, the format of the droplet field, doubles the traffic of RGBA8 to
+// show what half floats cost in the format benchmark
+const RenderTargetFormat RENDER_TARGET_FORMATS[] = {
+    { .name = "rgba8", .format = GL_RGBA8, .bytes_per_pixel = 4, .alpha = true },
+    { .name = "rgb10_a2", .format = GL_RGB10_A2, .bytes_per_pixel = 4, .alpha = true },
+    { .name = "r11g11b10f", .format = GL_R11F_G11F_B10F, .bytes_per_pixel = 4, .alpha = false },
+    { .name = "rgb565", .format = GL_RGB565, .bytes_per_pixel = 2, .alpha = false },
+    { .name = "rgba16f", .format = GL_RGBA16F, .bytes_per_pixel = 8, .alpha = true },
 };
 
 struct RenderTarget {
@@ -89,16 +297,56 @@ struct RenderTarget {
     GLuint texture;
     int32_t width;
     int32_t height;
+    GLenum format;
+    // mip levels, 1 for a plain target
+    int32_t levels;
 };
 
 struct Resources {
+    // what the passes draw with
+    const Renderer* renderer;
     Shaders shaders;
     Buffers buffers;
+    // either a plain texture, a virtual texture for images the GPU cannot take
+    // whole, or the texture array of a playlist
     GLuint texture;
-    RenderTarget render_target;
-    RenderTarget droplet_render_target;
+    std::optional<VirtualTexture> virtual_texture;
+    std::optional<Playlist> playlist;
+    int32_t texture_width;
+    int32_t texture_height;
+    // sized for the largest render size, the image resolution
+    DropletTiles droplet_tiles;
+    Blur blur;
+    std::optional<WetGlass> wet_glass;
+    std::optional<DropletPhysics> droplet_physics;
+    std::optional<DropletSprites> droplet_sprites;
+    // droplet programs compiled so far, keyed by the #defines of their permutation
+    std::map<std::string, DropletPrograms> droplet_programs;
     RainVertex rain_vertices[RAIN_VERTICES_COUNT];
 };
 
 std::optional<Resources> resourcesInit(Config config, std::uniform_real_distribution<>& dis, std::mt19937& gen);
 void resourcesDeinit(Resources* p_resources);
+std::optional<GLuint> compileShader(const ShaderCodes shader_codes);
+std::optional<GLuint> compileComputeShader(const GLchar* code);
+// location of the uniform in a program from compileShader or
+// compileComputeShader, -1 if the program does not use it
+GLint uniformLocation(GLuint program, Uniform uniform);
+// GL 4.5 or ARB_direct_state_access: resources are then created and
+// filled without binding them
+bool dsaSupported();
+// binds the buffer to FRAME_UNIFORMS_BINDING with the new contents
+void frameUniformsUpload(const Buffers& buffers, const FrameUniforms& uniforms);
+// the first count vertices of the rain
+void rainVerticesUpload(const Buffers& buffers, const RainVertex* vertices, uint32_t count);
+// switches Shaders::droplet to the programs of the quality, compiling them on first use
+bool resourcesUseDropletQuality(Resources* p_resources, const DropletQuality& quality, bool wet_glass);
+std::optional<RenderTargetFormat> renderTargetFormat(const std::string& name);
+std::optional<RenderTargetFormat> renderTargetFormat(GLenum format);
+// the texture gets immutable storage, so resizing means a new target
+// the full mip chain down to 1x1
+int32_t renderTargetLevels(int32_t width, int32_t height);
+// targets with more than one level are filtered trilinearly, the framebuffer
+// renders into level 0
+std::optional<RenderTarget> renderTargetInit(int32_t width, int32_t height, GLenum format, int32_t levels = 1);
+void renderTargetDeinit(RenderTarget* p_render_target);
@@ -0,0 +1,400 @@
+#include "virtual_texture.h"
+
+#include <glad/gl.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+#include "resources.h"
+
+#ifdef _WIN32
+#define fseek64 _fseeki64
+#else
+#define fseek64 fseeko
+#endif
+
+struct VirtualTextureHeader {
+    char magic[4];
+    int32_t tile_size;
+    int32_t width;
+    int32_t height;
+};
+
+int32_t computeLevels(int32_t width, int32_t height, VirtualTextureLevel* levels);
+void viewTiles(const VirtualTextureLevel& level, glm::vec4 view, int32_t* p_first_x, int32_t* p_first_y, int32_t* p_last_x, int32_t* p_last_y);
+bool bakeTiles(const std::string& filename, const std::string& tiles_filename);
+void writeLevelTiles(std::FILE* file, const unsigned char* pixels, int32_t width, int32_t height, unsigned char* tile);
+std::optional<int32_t> cacheSlot(VirtualTexture* p_vt);
+
+std::optional<VirtualTexture> virtualTextureInit(const std::string& filename) {
+    const std::string tiles_filename = filename + ".tiles";
+
+    std::error_code error;
+    const bool stale = !std::filesystem::exists(tiles_filename, error)
+        || std::filesystem::last_write_time(tiles_filename, error) < std::filesystem::last_write_time(filename, error);
+    if (stale) {
+        std::println("INFO: Baking tiles of \"{}\" into \"{}\"", filename, tiles_filename);
+        if (!bakeTiles(filename, tiles_filename)) return std::nullopt;
+    }
+
+    std::FILE* file = std::fopen(tiles_filename.c_str(), "rb");
+    if (file == NULL) {
+        std::println("ERR: Failed to open tile file \"{}\"", tiles_filename);
+        return std::nullopt;
+    }
+    VirtualTextureHeader header = {};
+    if (std::fread(&header, sizeof(header), 1, file) != 1
+        || std::memcmp(header.magic, "CGVT", 4) != 0
+        || header.tile_size != VT_TILE_SIZE
+    ) {
+        std::println("ERR: Invalid tile file \"{}\", delete it to bake it again", tiles_filename);
+        std::fclose(file);
+        return std::nullopt;
+    }
+
+    VirtualTexture vt = {};
+    vt.file = file;
+    vt.width = header.width;
+    vt.height = header.height;
+    vt.level_count = computeLevels(header.width, header.height, vt.levels);
+    if (vt.level_count == 0) {
+        std::println("ERR: Image \"{}\" is too large for the virtual texture", filename);
+        std::fclose(file);
+        return std::nullopt;
+    }
+    // nothing streamed in yet
+    vt.level = vt.level_count;
+    vt.pending = true;
+
+    const VirtualTextureLevel& last = vt.levels[vt.level_count - 1];
+    const size_t tile_count = last.first_tile + last.tiles_x * last.tiles_y;
+    const int32_t indirection_width = vt.levels[0].tiles_x;
+    const int32_t indirection_height = last.indirection_row + last.tiles_y;
+
+    vt.tile_slot.assign(tile_count, -1);
+    vt.slot_tile.assign(VT_CACHE_TILES * VT_CACHE_TILES, -1);
+    vt.slot_last_used.assign(VT_CACHE_TILES * VT_CACHE_TILES, 0);
+    vt.indirection_data.assign(4 * indirection_width * indirection_height, 0);
+    vt.frame = 0;
+
+    glGenTextures(1, &vt.cache);
+    glStateBindTexture(0, vt.cache);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, VT_CACHE_TILES * VT_TILE_SIZE, VT_CACHE_TILES * VT_TILE_SIZE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glGenTextures(1, &vt.indirection);
+    glStateBindTexture(0, vt.indirection);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8UI, indirection_width, indirection_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, indirection_width, indirection_height, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, vt.indirection_data.data());
+    glStateBindTexture(0, 0);
+
+    std::println("INFO: Virtual texture {}x{}, {} levels, {} tiles", vt.width, vt.height, vt.level_count, tile_count);
+    return vt;
+}
+
+bool virtualTextureUpdate(VirtualTexture* p_vt, int32_t target_width, int32_t target_height, glm::vec4 view) {
+    p_vt->frame += 1;
+
+    // the coarsest level that still has at least as many texels across the
+    // view as the target
+    int32_t level = 0;
+    while (level + 1 < p_vt->level_count
+        && p_vt->levels[level + 1].width * view.z >= target_width
+        && p_vt->levels[level + 1].height * view.w >= target_height
+    ) {
+        level += 1;
+    }
+    // the tiles in view of the level and of the next coarser one the shader
+    // blends it with, plus the fallback tile, must fit in the cache
+    int32_t first_x, first_y, last_x, last_y;
+    int32_t coarser_first_x, coarser_first_y, coarser_last_x, coarser_last_y;
+    while (true) {
+        viewTiles(p_vt->levels[level], view, &first_x, &first_y, &last_x, &last_y);
+        if (level + 1 == p_vt->level_count) break;
+
+        viewTiles(p_vt->levels[level + 1], view, &coarser_first_x, &coarser_first_y, &coarser_last_x, &coarser_last_y);
+        const int32_t tiles = (last_x - first_x + 1) * (last_y - first_y + 1)
+            + (coarser_last_x - coarser_first_x + 1) * (coarser_last_y - coarser_first_y + 1);
+        if (tiles + 1 <= VT_CACHE_TILES * VT_CACHE_TILES) break;
+        level += 1;
+    }
+    bool changed = level != p_vt->level;
+    p_vt->level = level;
+
+    // the single tile of the coarsest level is always kept as a fallback
+    std::vector<size_t> needed;
+    const VirtualTextureLevel& last = p_vt->levels[p_vt->level_count - 1];
+    needed.push_back(last.first_tile);
+    if (level != p_vt->level_count - 1) {
+        const VirtualTextureLevel& current = p_vt->levels[level];
+        for (int32_t y = first_y; y <= last_y; y++) {
+            for (int32_t x = first_x; x <= last_x; x++) {
+                needed.push_back(current.first_tile + y * current.tiles_x + x);
+            }
+        }
+    }
+    // the coarser level goes after, so the tiles of the level come in first
+    if (level + 2 < p_vt->level_count) {
+        const VirtualTextureLevel& coarser = p_vt->levels[level + 1];
+        for (int32_t y = coarser_first_y; y <= coarser_last_y; y++) {
+            for (int32_t x = coarser_first_x; x <= coarser_last_x; x++) {
+                needed.push_back(coarser.first_tile + y * coarser.tiles_x + x);
+            }
+        }
+    }
+
+    std::vector<size_t> missing;
+    for (size_t tile : needed) {
+        const int32_t slot = p_vt->tile_slot[tile];
+        if (slot < 0) missing.push_back(tile);
+        else p_vt->slot_last_used[slot] = p_vt->frame;
+    }
+
+    std::vector<unsigned char> pixels(VT_TILE_BYTES);
+    size_t uploaded = 0;
+    for (size_t tile : missing) {
+        if (uploaded == VT_UPLOADS_PER_FRAME) break;
+
+        auto slot = cacheSlot(p_vt);
+        if (!slot) break;
+
+        if (fseek64(p_vt->file, sizeof(VirtualTextureHeader) + tile * VT_TILE_BYTES, SEEK_SET) != 0
+            || std::fread(pixels.data(), VT_TILE_BYTES, 1, p_vt->file) != 1
+        ) {
+            std::println("ERR: Failed to read tile {} from the tile file", tile);
+            break;
+        }
+
+        const int32_t slot_x = slot.value() % VT_CACHE_TILES;
+        const int32_t slot_y = slot.value() / VT_CACHE_TILES;
+        glStateBindTexture(0, p_vt->cache);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, slot_x * VT_TILE_SIZE, slot_y * VT_TILE_SIZE, VT_TILE_SIZE, VT_TILE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        p_vt->slot_tile[slot.value()] = tile;
+        p_vt->slot_last_used[slot.value()] = p_vt->frame;
+        p_vt->tile_slot[tile] = slot.value();
+        uploaded += 1;
+    }
+    p_vt->pending = uploaded < missing.size();
+
+    if (uploaded == 0) return changed;
+
+    // rebuild the table from the resident tiles, it is tiny next to a tile
+    std::fill(p_vt->indirection_data.begin(), p_vt->indirection_data.end(), 0);
+    const int32_t indirection_width = p_vt->levels[0].tiles_x;
+    for (int32_t l = 0; l < p_vt->level_count; l++) {
+        const VirtualTextureLevel& lvl = p_vt->levels[l];
+        for (int32_t y = 0; y < lvl.tiles_y; y++) {
+            for (int32_t x = 0; x < lvl.tiles_x; x++) {
+                const int32_t slot = p_vt->tile_slot[lvl.first_tile + y * lvl.tiles_x + x];
+                if (slot < 0) continue;
+
+                uint8_t* entry = &p_vt->indirection_data[4 * ((lvl.indirection_row + y) * indirection_width + x)];
+                entry[0] = slot % VT_CACHE_TILES;
+                entry[1] = slot / VT_CACHE_TILES;
+                entry[2] = 1;
+            }
+        }
+    }
+    glStateBindTexture(0, p_vt->indirection);
+    glTexSubImage2D(
+        GL_TEXTURE_2D, 0, 0, 0,
+        indirection_width, int32_t(p_vt->indirection_data.size() / 4 / indirection_width),
+        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, p_vt->indirection_data.data()
+    );
+
+    return true;
+}
+
+void virtualTextureBind(const VirtualTexture& vt, GLuint program) {
+    GLint offsets[2 * VT_MAX_LEVELS] = {};
+    GLint tiles[2 * VT_MAX_LEVELS] = {};
+    GLfloat sizes[2 * VT_MAX_LEVELS] = {};
+    for (int32_t l = 0; l < vt.level_count; l++) {
+        offsets[2*l + 1] = vt.levels[l].indirection_row;
+        tiles[2*l] = vt.levels[l].tiles_x;
+        tiles[2*l + 1] = vt.levels[l].tiles_y;
+        sizes[2*l] = vt.levels[l].width;
+        sizes[2*l + 1] = vt.levels[l].height;
+    }
+
+    glStateUseProgram(program);
+    glUniform1i(uniformLocation(program, UNIFORM_LEVEL), std::min(vt.level, vt.level_count - 1));
+    glUniform1i(uniformLocation(program, UNIFORM_LEVEL_COUNT), vt.level_count);
+    glUniform2iv(uniformLocation(program, UNIFORM_LEVEL_OFFSET), VT_MAX_LEVELS, offsets);
+    glUniform2iv(uniformLocation(program, UNIFORM_LEVEL_TILES), VT_MAX_LEVELS, tiles);
+    glUniform2fv(uniformLocation(program, UNIFORM_LEVEL_SIZE), VT_MAX_LEVELS, sizes);
+
+    glStateBindTexture(1, vt.indirection);
+    glStateBindTexture(0, vt.cache);
+}
+
+void virtualTextureDeinit(VirtualTexture* p_vt) {
+    if (p_vt->file != NULL) std::fclose(p_vt->file);
+    glStateDeleteTextures(1, &p_vt->cache);
+    glStateDeleteTextures(1, &p_vt->indirection);
+
+    p_vt->file = NULL;
+    p_vt->cache = 0;
+    p_vt->indirection = 0;
+}
+
+// the range of tiles of the level the view overlaps
+void viewTiles(const VirtualTextureLevel& level, glm::vec4 view, int32_t* p_first_x, int32_t* p_first_y, int32_t* p_last_x, int32_t* p_last_y) {
+    *p_first_x = std::clamp(int32_t(std::floor(view.x * level.width / VT_TILE_PAYLOAD)), 0, level.tiles_x - 1);
+    *p_first_y = std::clamp(int32_t(std::floor(view.y * level.height / VT_TILE_PAYLOAD)), 0, level.tiles_y - 1);
+    *p_last_x = std::clamp(int32_t(std::ceil((view.x + view.z) * level.width / VT_TILE_PAYLOAD)) - 1, *p_first_x, level.tiles_x - 1);
+    *p_last_y = std::clamp(int32_t(std::ceil((view.y + view.w) * level.height / VT_TILE_PAYLOAD)) - 1, *p_first_y, level.tiles_y - 1);
+}
+
+// returns 0 when the image needs more than VT_MAX_LEVELS levels
+int32_t computeLevels(int32_t width, int32_t height, VirtualTextureLevel* levels) {
+    int32_t count = 0;
+    int32_t indirection_row = 0;
+    size_t first_tile = 0;
+    while (count < VT_MAX_LEVELS) {
+        const int32_t tiles_x = (width + VT_TILE_PAYLOAD - 1) / VT_TILE_PAYLOAD;
+        const int32_t tiles_y = (height + VT_TILE_PAYLOAD - 1) / VT_TILE_PAYLOAD;
+        levels[count] = VirtualTextureLevel{
+            .width = width,
+            .height = height,
+            .tiles_x = tiles_x,
+            .tiles_y = tiles_y,
+            .indirection_row = indirection_row,
+            .first_tile = first_tile,
+        };
+        count += 1;
+        if (tiles_x == 1 && tiles_y == 1) return count;
+
+        indirection_row += tiles_y;
+        first_tile += tiles_x * tiles_y;
+        width = std::max(1, (width + 1) / 2);
+        height = std::max(1, (height + 1) / 2);
+    }
+    return 0;
+}
+
+// stb_image can only decode whole images, so this is the one place the full
+// image is in memory. It also refuses images of more than INT_MAX bytes once
+// decoded, so at most about 536M pixels (e.g. 23170x23170) can be baked.
+bool bakeTiles(const std::string& filename, const std::string& tiles_filename) {
+    stbi_set_flip_vertically_on_load(true);
+    int32_t width, height, n;
+    unsigned char* image = stbi_load(filename.c_str(), &width, &height, &n, 4);
+    if (image == NULL) {
+        std::println(
+            "ERR: Failed to load image \"{}\": {} (images are decoded whole to RGBA8, which stb_image limits to INT_MAX bytes, about 536M pixels)",
+            filename, stbi_failure_reason()
+        );
+        return false;
+    }
+
+    VirtualTextureLevel levels[VT_MAX_LEVELS];
+    const int32_t level_count = computeLevels(width, height, levels);
+    if (level_count == 0) {
+        std::println("ERR: Image \"{}\" is too large for the virtual texture", filename);
+        stbi_image_free(image);
+        return false;
+    }
+
+    std::FILE* file = std::fopen(tiles_filename.c_str(), "wb");
+    if (file == NULL) {
+        std::println("ERR: Failed to create tile file \"{}\"", tiles_filename);
+        stbi_image_free(image);
+        return false;
+    }
+    VirtualTextureHeader header = {
+        .magic = {'C', 'G', 'V', 'T'},
+        .tile_size = VT_TILE_SIZE,
+        .width = width,
+        .height = height,
+    };
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    std::vector<unsigned char> tile(VT_TILE_BYTES);
+    writeLevelTiles(file, image, width, height, tile.data());
+    std::vector<unsigned char> level;
+    if (level_count > 1) level = downsample(image, width, height, levels[1].width, levels[1].height);
+    stbi_image_free(image);
+
+    for (int32_t l = 1; l < level_count; l++) {
+        writeLevelTiles(file, level.data(), levels[l].width, levels[l].height, tile.data());
+        if (l + 1 < level_count) {
+            level = downsample(level.data(), levels[l].width, levels[l].height, levels[l + 1].width, levels[l + 1].height);
+        }
+    }
+
+    const bool ok = std::ferror(file) == 0;
+    std::fclose(file);
+    if (!ok) {
+        std::println("ERR: Failed to write tile file \"{}\"", tiles_filename);
+        std::filesystem::remove(tiles_filename);
+    }
+    return ok;
+}
+
+void writeLevelTiles(std::FILE* file, const unsigned char* pixels, int32_t width, int32_t height, unsigned char* tile) {
+    const int32_t tiles_x = (width + VT_TILE_PAYLOAD - 1) / VT_TILE_PAYLOAD;
+    const int32_t tiles_y = (height + VT_TILE_PAYLOAD - 1) / VT_TILE_PAYLOAD;
+    for (int32_t ty = 0; ty < tiles_y; ty++) {
+        for (int32_t tx = 0; tx < tiles_x; tx++) {
+            // the border repeats the neighbouring tiles, or the edge of the image
+            for (int32_t y = 0; y < VT_TILE_SIZE; y++) {
+                const int32_t sy = std::clamp(ty * VT_TILE_PAYLOAD - VT_TILE_BORDER + y, 0, height - 1);
+                for (int32_t x = 0; x < VT_TILE_SIZE; x++) {
+                    const int32_t sx = std::clamp(tx * VT_TILE_PAYLOAD - VT_TILE_BORDER + x, 0, width - 1);
+                    std::memcpy(&tile[4 * (y * VT_TILE_SIZE + x)], &pixels[4 * (size_t(sy) * width + sx)], 4);
+                }
+            }
+            std::fwrite(tile, VT_TILE_BYTES, 1, file);
+        }
+    }
+}
+
+// 2x2 box filter, odd edges repeat the last texel
+std::vector<unsigned char> downsample(const unsigned char* pixels, int32_t width, int32_t height, int32_t out_width, int32_t out_height) {
+    std::vector<unsigned char> out(4 * size_t(out_width) * out_height);
+    for (int32_t y = 0; y < out_height; y++) {
+        const int32_t y0 = std::min(2*y, height - 1);
+        const int32_t y1 = std::min(2*y + 1, height - 1);
+        for (int32_t x = 0; x < out_width; x++) {
+            const int32_t x0 = std::min(2*x, width - 1);
+            const int32_t x1 = std::min(2*x + 1, width - 1);
+            for (int32_t c = 0; c < 4; c++) {
+                const uint32_t sum = pixels[4 * (size_t(y0) * width + x0) + c]
+                    + pixels[4 * (size_t(y0) * width + x1) + c]
+                    + pixels[4 * (size_t(y1) * width + x0) + c]
+                    + pixels[4 * (size_t(y1) * width + x1) + c];
+                out[4 * (size_t(y) * out_width + x) + c] = (sum + 2) / 4;
+            }
+        }
+    }
+    return out;
+}
+
+// a free slot, or the least recently used one that is not needed this frame
+std::optional<int32_t> cacheSlot(VirtualTexture* p_vt) {
+    int32_t best = -1;
+    for (int32_t slot = 0; slot < int32_t(p_vt->slot_tile.size()); slot++) {
+        if (p_vt->slot_tile[slot] < 0) return slot;
+        if (p_vt->slot_last_used[slot] == p_vt->frame) continue;
+        if (best < 0 || p_vt->slot_last_used[slot] < p_vt->slot_last_used[best]) best = slot;
+    }
+    if (best < 0) return std::nullopt;
+
+    p_vt->tile_slot[p_vt->slot_tile[best]] = -1;
+    p_vt->slot_tile[best] = -1;
+    return best;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+// tiles are stored and cached with a border so bilinear filtering does not
+// need the neighbouring tile
+#define VT_TILE_SIZE 128
+#define VT_TILE_BORDER 1
+#define VT_TILE_PAYLOAD (VT_TILE_SIZE - 2*VT_TILE_BORDER)
+#define VT_TILE_BYTES (VT_TILE_SIZE * VT_TILE_SIZE * 4)
+// the tile cache texture is VT_CACHE_TILES x VT_CACHE_TILES tiles
+#define VT_CACHE_TILES 32
+#define VT_MAX_LEVELS 16
+// tiles read from disk and uploaded per frame, so streaming never hitches
+#define VT_UPLOADS_PER_FRAME 16
+
+struct VirtualTextureLevel {
+    int32_t width;
+    int32_t height;
+    int32_t tiles_x;
+    int32_t tiles_y;
+    // first row of this level in the indirection table
+    int32_t indirection_row;
+    // index of the first tile of this level in the tile file
+    size_t first_tile;
+};
+
+// A mip-mapped image split into tiles in a file next to it, of which only the
+// tiles of the visible part needed at the current render size are kept in a
+// fixed size cache texture. The indirection table maps every tile of every level to its slot
+// in the cache.
+struct VirtualTexture {
+    std::FILE* file;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    VirtualTextureLevel levels[VT_MAX_LEVELS];
+    // finest level currently streamed in
+    int32_t level;
+    // tiles still missing from the cache
+    bool pending;
+
+    GLuint cache;
+    GLuint indirection;
+    std::vector<uint8_t> indirection_data;
+
+    // cache slot -> tile, and tile -> cache slot, -1 when empty / not resident
+    std::vector<int64_t> slot_tile;
+    std::vector<int32_t> tile_slot;
+    std::vector<uint64_t> slot_last_used;
+    uint64_t frame;
+};
+
+// Bakes the tile file "<filename>.tiles" if it is missing or older than the
+// image, then opens it. The image is only decoded when baking.
+std::optional<VirtualTexture> virtualTextureInit(const std::string& filename);
+// Streams in the tiles needed to draw the part of the image in view (corner
+// in xy and size in zw, in uv) into a target of the given size, returns true
+// when the contents of the cache changed.
+bool virtualTextureUpdate(VirtualTexture* p_vt, int32_t target_width, int32_t target_height, glm::vec4 view);
+// binds the cache to texture unit 0, the indirection table to unit 1 and sets
+// the uniforms of the virtual texture shader
+void virtualTextureBind(const VirtualTexture& vt, GLuint program);
+void virtualTextureDeinit(VirtualTexture* p_vt);
+// the next mip level of an RGBA8 image, averaging 2x2 texels
+std::vector<unsigned char> downsample(const unsigned char* pixels, int32_t width, int32_t height, int32_t out_width, int32_t out_height);
@@ -0,0 +1,86 @@
+#include "wet_glass.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <print>
+
+#include "gl_state.h"
+#include "resources.h"
+
+std::optional<WetGlass> wetGlassInit(int32_t image_width, int32_t image_height) {
+    const int32_t height = WET_GLASS_HEIGHT;
+    const int32_t width = std::clamp(int32_t(std::round(float(height) * image_width / image_height)), 1, WET_GLASS_MAX_WIDTH);
+
+    WetGlass wet_glass = {
+        .width = width,
+        .height = height,
+    };
+    for (int32_t i = 0; i < 2; i++) {
+        auto target = renderTargetInit(width, height, GL_RGBA16F);
+        if (!target) {
+            wetGlassDeinit(&wet_glass);
+            return std::nullopt;
+        }
+        wet_glass.textures[i] = target->texture;
+        wet_glass.framebuffers[i] = target->framebuffer;
+
+        // the glass starts dry
+        glStateBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // the gradient of the water is taken across the edges too
+        if (dsaSupported()) {
+            glTextureParameteri(target->texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(target->texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        } else {
+            glStateBindTexture(0, target->texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+    }
+    glStateBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::println("INFO: Wet glass simulated at {}x{}", width, height);
+    return wet_glass;
+}
+
+void wetGlassUpdate(const Renderer& renderer, WetGlass* p_wet_glass, GLuint program, double time) {
+    int32_t steps = int32_t(std::floor((time - p_wet_glass->time) * WET_GLASS_STEPS_PER_SECOND));
+    if (steps <= 0) return;
+    if (steps > WET_GLASS_MAX_STEPS) {
+        steps = WET_GLASS_MAX_STEPS;
+        p_wet_glass->time = time;
+    } else {
+        p_wet_glass->time += steps / WET_GLASS_STEPS_PER_SECOND;
+    }
+
+    glStateUseProgram(program);
+    const GLint step_location = uniformLocation(program, UNIFORM_STEP);
+    for (int32_t i = 0; i < steps; i++) {
+        const int32_t next = 1 - p_wet_glass->current;
+        glUniform1ui(step_location, p_wet_glass->step);
+        renderer.bind_texture(WET_GLASS_UNIT, p_wet_glass->textures[p_wet_glass->current], RENDERER_TEXTURE_2D);
+        renderer.bind_storage_image(0, p_wet_glass->textures[next], RENDERER_FORMAT_RGBA16F);
+        renderer.dispatch(program, (p_wet_glass->width + 7) / 8, (p_wet_glass->height + 7) / 8);
+        // read by the next step and the droplet passes
+        renderer.barrier(RENDERER_BARRIER_TEXTURE_FETCH);
+
+        p_wet_glass->current = next;
+        p_wet_glass->step += 1;
+    }
+}
+
+void wetGlassBind(const WetGlass& wet_glass) {
+    glStateBindTexture(WET_GLASS_UNIT, wet_glass.textures[wet_glass.current]);
+}
+
+void wetGlassDeinit(WetGlass* p_wet_glass) {
+    glStateDeleteFramebuffers(2, p_wet_glass->framebuffers);
+    glStateDeleteTextures(2, p_wet_glass->textures);
+    *p_wet_glass = {};
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstdint>
+#include <optional>
+
+#include "renderer.h"
+
+// rows of the simulation, the columns follow the aspect ratio of the image
+#define WET_GLASS_HEIGHT 256
+#define WET_GLASS_MAX_WIDTH 1024
+#define WET_GLASS_STEPS_PER_SECOND 60.0
+// steps caught up in one frame, after a longer hitch the simulation just
+// falls behind
+#define WET_GLASS_MAX_STEPS 4
+// texture unit the current state is read from
+#define WET_GLASS_UNIT 5
+
+// Water on the glass simulated in a pair of small RGBA16F textures, one
+// step reading the state the previous one wrote (see dropletsWetGlass.h).
+// Droplets condense, merge, run down once heavy enough and leave a fading
+// wet trail. It runs at a fixed resolution and rate whatever the image or
+// render size, and the droplet field pass turns it into the distortion
+// field the composite samples.
+struct WetGlass {
+    GLuint textures[2];
+    GLuint framebuffers[2];
+    int32_t width;
+    int32_t height;
+    // the texture holding the latest state
+    int32_t current;
+    // simulated time and steps
+    double time;
+    uint32_t step;
+};
+
+std::optional<WetGlass> wetGlassInit(int32_t image_width, int32_t image_height);
+// steps the simulation up to the given time with the step program
+void wetGlassUpdate(const Renderer& renderer, WetGlass* p_wet_glass, GLuint program, double time);
+// binds the latest state to WET_GLASS_UNIT
+void wetGlassBind(const WetGlass& wet_glass);
+void wetGlassDeinit(WetGlass* p_wet_glass);
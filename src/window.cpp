@@ -5,16 +5,25 @@
 
 #include <print>
 
+#include "gl_trace.h"
+
 const uint32_t SCR_WIDTH = 800;
 const uint32_t SCR_HEIGHT = 600;
 
 GLFWwindow* windowInit() {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Rain", NULL, NULL);
+    // 4.5 for direct state access, the renderer itself only needs 4.3
+    const int versions[2][2] = { {4, 5}, {4, 3} };
+    GLFWwindow* window = NULL;
+    for (const auto& version : versions) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Rain", NULL, NULL);
+        if (window != NULL) break;
+        std::println("INFO: No OpenGL {}.{} context", version[0], version[1]);
+    }
     if (window == NULL) {
         std::println("ERR: Failed to create GLFW window");
         glfwTerminate();
@@ -29,6 +38,7 @@ GLFWwindow* windowInit() {
         return nullptr;
     }
     std::println("INFO: Initialized OpenGL window OpenGL version {}.{}", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+    glTraceInit();
 
     std::println("INFO: GL Version: {}", (char*)glGetString(GL_VERSION));
     std::println("INFO: GLSL Version: {}", (char*)glGetString(GL_SHADING_LANGUAGE_VERSION));